@@ -0,0 +1,165 @@
+#include "alcazam.h"
+#include "solver.h"
+#include "bitboard.h"
+#include <stdlib.h>
+#include <string.h>
+
+// caller edge arrays are used as solver boards directly
+typedef char uint_is_32_bits[(sizeof(uint) == sizeof(uint32_t)) ? 1 : -1];
+
+struct alcazam
+{
+	solver_t solver;
+	bitboard_t bitboard;
+	worklist_t worklist;
+	board_t test;		// harden scratch, sized for the largest board
+	uint *trials;
+	mt_state_t rng;
+};
+
+alcazam_error_t alcazam_create(alcazam_t **context, uint32_t max_width, uint32_t max_height, uint32_t flags, unsigned long seed)
+{
+	if (!context) {
+		return ALCAZAM_INVALID_ARGUMENT;
+	}
+	*context = NULL;
+	if (max_width == 0 || max_height == 0) {
+		return ALCAZAM_INVALID_ARGUMENT;
+	}
+	if (!is_board_size_supported(max_width, max_height)) {
+		return ALCAZAM_BOARD_TOO_LARGE;
+	}
+
+	alcazam_t *const ctx = (alcazam_t *)calloc(1, sizeof(alcazam_t));
+	if (!ctx) {
+		return ALCAZAM_OUT_OF_MEMORY;
+	}
+	board_t capacity;
+	memset(&capacity, 0, sizeof(board_t));
+	capacity.width = max_width;
+	capacity.height = max_height;
+	bool is_allocated = init_solver(&ctx->solver, &capacity);
+	if (flags & ALCAZAM_BITBOARD) {
+		is_allocated = init_bitboard(&ctx->bitboard, &capacity) && is_allocated;
+		ctx->solver.bitboard = &ctx->bitboard;
+	}
+	if (flags & ALCAZAM_EVENT_DRIVEN) {
+		is_allocated = init_worklist(&ctx->worklist, &capacity) && is_allocated;
+		ctx->solver.worklist = &ctx->worklist;
+	}
+	ctx->test.edge_h = (uint *)malloc((size_t)max_width*(max_height + 1)*sizeof(uint));
+	ctx->test.edge_v = (uint *)malloc((size_t)(max_width + 1)*max_height*sizeof(uint));
+	ctx->trials = (uint *)malloc(2*((size_t)max_width + 1)*(max_height + 1)*sizeof(uint));
+	init_genrand(&ctx->rng, seed);
+
+	if (!is_allocated || !ctx->test.edge_h || !ctx->test.edge_v || !ctx->trials) {
+		alcazam_free(ctx);
+		return ALCAZAM_OUT_OF_MEMORY;
+	}
+	*context = ctx;
+	return ALCAZAM_OK;
+}
+
+void alcazam_free(alcazam_t *context)
+{
+	if (!context) {
+		return;
+	}
+	if (context->solver.worklist) {
+		free_worklist(&context->worklist);
+	}
+	if (context->solver.bitboard) {
+		free_bitboard(&context->bitboard);
+	}
+	free_solver(&context->solver);
+	free_board(&context->test);
+	free(context->trials);
+	free(context);
+}
+
+void alcazam_seed(alcazam_t *context, unsigned long seed)
+{
+	init_genrand(&context->rng, seed);
+}
+
+static
+alcazam_error_t check_board(alcazam_t const *context, alcazam_board_t const *board)
+{
+	if (!context || !board || !board->edge_h || !board->edge_v || board->width == 0 || board->height == 0) {
+		return ALCAZAM_INVALID_ARGUMENT;
+	}
+	if (board->width > context->solver.capacity_width || board->height > context->solver.capacity_height) {
+		return ALCAZAM_BOARD_TOO_LARGE;
+	}
+	return ALCAZAM_OK;
+}
+
+static
+void wrap_board(board_t *dst, alcazam_board_t const *src)
+{
+	dst->width = src->width;
+	dst->height = src->height;
+	dst->edge_h = (uint *)src->edge_h;
+	dst->edge_v = (uint *)src->edge_v;
+}
+
+alcazam_error_t alcazam_solve(alcazam_t *context, alcazam_board_t *board, alcazam_result_t *result, uint32_t *step_count)
+{
+	alcazam_error_t const error = check_board(context, board);
+	if (error != ALCAZAM_OK) {
+		return error;
+	}
+	board_t b;
+	wrap_board(&b, board);
+	reset_to_boundary(&b);
+
+	solve_status_t status;
+	uint const count = solve(&context->solver, &b, &status);
+	if (result) {
+		*result = (alcazam_result_t)status;
+	}
+	if (step_count) {
+		*step_count = count;
+	}
+	return ALCAZAM_OK;
+}
+
+alcazam_error_t alcazam_harden(alcazam_t *context, alcazam_board_t *board, uint32_t *removed_count)
+{
+	alcazam_error_t const error = check_board(context, board);
+	if (error != ALCAZAM_OK) {
+		return error;
+	}
+	board_t b;
+	wrap_board(&b, board);
+	reset_to_boundary(&b);
+
+	uint const count = harden_with_scratch(&context->solver, &b, &context->rng, &context->test, context->trials);
+
+	// hardening swaps edge storage with the scratch board, hand the caller back their own arrays
+	if (b.edge_h != (uint *)board->edge_h) {
+		copy_board_edges(&context->test, &b);
+		swap_board(&context->test, &b);
+	}
+	for (uint i = 0; i < b.width*(b.height + 1); ++i) {
+		b.edge_h[i] &= ALCAZAM_EDGE_WALL;
+	}
+	for (uint i = 0; i < (b.width + 1)*b.height; ++i) {
+		b.edge_v[i] &= ALCAZAM_EDGE_WALL;
+	}
+	if (removed_count) {
+		*removed_count = count;
+	}
+	return ALCAZAM_OK;
+}
+
+char const *alcazam_error_string(alcazam_error_t error)
+{
+	switch (error) {
+		case ALCAZAM_OK:				return "ok";
+		case ALCAZAM_INVALID_ARGUMENT:	return "invalid argument";
+		case ALCAZAM_BOARD_TOO_LARGE:	return "board too large";
+		case ALCAZAM_OUT_OF_MEMORY:		return "out of memory";
+	}
+	return "unknown error";
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+// embeddable solver: a context owns every buffer it needs, so solve and harden never allocate
+// contexts share no state, use one per thread
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define ALCAZAM_API __attribute__((visibility("default")))
+#else
+#define ALCAZAM_API
+#endif
+
+// edge bits, only ALCAZAM_EDGE_WALL is read, solve adds the others
+#define ALCAZAM_EDGE_WALL		0x01U
+#define ALCAZAM_EDGE_BARRIER	0x02U	// path cannot use this edge
+#define ALCAZAM_EDGE_PATH		0x04U	// path uses this edge
+
+// context flags
+#define ALCAZAM_BITBOARD		0x01U	// word-parallel single cell check
+#define ALCAZAM_EVENT_DRIVEN	0x02U	// re-check only cells near changed edges
+
+typedef enum
+{
+	ALCAZAM_OK,
+	ALCAZAM_INVALID_ARGUMENT,
+	ALCAZAM_BOARD_TOO_LARGE,	// larger than the context was created for, or than the solver supports
+	ALCAZAM_OUT_OF_MEMORY
+} alcazam_error_t;
+
+typedef enum
+{
+	ALCAZAM_GIVEN_UP,			// no more deductions, board not complete
+	ALCAZAM_SOLVED,
+	ALCAZAM_CONTRADICTION
+} alcazam_result_t;
+
+// edges are owned by the caller and updated in place
+typedef struct
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t *edge_h;	// horizontal edges row by row: width*(height + 1)
+	uint32_t *edge_v;	// vertical edges row by row: (width + 1)*height
+} alcazam_board_t;
+
+typedef struct alcazam alcazam_t;
+
+// all allocation happens here, boards up to max_width x max_height can then be solved
+ALCAZAM_API alcazam_error_t alcazam_create(alcazam_t **context, uint32_t max_width, uint32_t max_height, uint32_t flags, unsigned long seed);
+ALCAZAM_API void alcazam_free(alcazam_t *context);
+ALCAZAM_API void alcazam_seed(alcazam_t *context, unsigned long seed);
+
+// deduce from the walls, leaving barrier and path bits on every edge that was decided
+ALCAZAM_API alcazam_error_t alcazam_solve(alcazam_t *context, alcazam_board_t *board, alcazam_result_t *result, uint32_t *step_count);
+
+// remove walls in a random order while the board still solves, leaves only wall bits
+ALCAZAM_API alcazam_error_t alcazam_harden(alcazam_t *context, alcazam_board_t *board, uint32_t *removed_count);
+
+ALCAZAM_API char const *alcazam_error_string(alcazam_error_t error);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,605 @@
+#define _POSIX_C_SOURCE 200809L
+#include "batch.h"
+#include "solver.h"
+#include "bitboard.h"
+#include "search.h"
+#include "stats.h"
+#include "io.h"
+#include "corpus.h"
+#include "justify.h"
+#include "schedule.h"
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+typedef struct job_t
+{
+	struct job_t *next;		// free list link
+	uint seq;				// position in the input, results are written in this order
+	char const *source;
+	uint index;				// puzzle index within the source
+	board_t board;			// edge storage is reused when the job is recycled
+	solve_status_t status;
+	uint step_count;
+	uint removed_count;
+	search_result_t search;
+	bool is_done;
+} job_t;
+
+struct batch_t;
+
+typedef struct
+{
+	struct batch_t *batch;
+	uint index;
+	pthread_t thread;
+	solver_t solver;		// scratch space private to this worker
+	bitboard_t bitboard;
+	worklist_t worklist;
+	justify_t justify;
+	schedule_t schedule;
+	stats_t stats;
+	pthread_mutex_t lock;	// guards the deque below
+	job_t **jobs;			// deque: owner takes from the front, thieves from the back
+	uint head;
+	uint count;
+} worker_t;
+
+typedef struct batch_t
+{
+	batch_options_t options;
+	uint worker_count;
+	worker_t *workers;
+	uint window;			// number of jobs, bounds how far the reader runs ahead
+	job_t *job_storage;
+	job_t *free_jobs;
+	job_t **slots;			// in flight jobs by seq % window
+	char **sources;			// names that jobs point into, freed at the end
+	uint source_count;
+	uint next_worker;
+	pthread_mutex_t lock;	// guards everything below, job free list and slots
+	uint next_seq;
+	pthread_cond_t job_ready;
+	pthread_cond_t job_done;
+	pthread_cond_t job_free;
+	uint queued_count;		// jobs in deques not yet reserved by a worker
+	bool is_reading_done;
+	uint puzzle_count;
+	uint solved_count;
+	uint contradiction_count;
+	bool result;
+	corpus_writer_t pack;	// with pack_path, written in input order by the writer
+} batch_t;
+
+static
+char const *result_name(solve_status_t status)
+{
+	switch (status) {
+		case SOLVE_SOLVED:			return "solved";
+		case SOLVE_CONTRADICTION:	return "contradiction";
+		default:					return "given up";
+	}
+}
+
+static
+void solve_job(worker_t *worker, job_t *job)
+{
+	batch_t const *const batch = worker->batch;
+	solver_t *const solver = &worker->solver;
+	board_t *const board = &job->board;
+	reserve_solver(solver, board);
+
+	// seeded by input position so results do not depend on which worker runs the job
+	job->removed_count = 0;
+	if (batch->options.try_removing_edges) {
+		mt_state_t rng;
+		init_genrand(&rng, batch->options.seed + job->seq);
+		job->removed_count = harden(solver, board, &rng);
+	}
+
+	// the deduction record is only for hardening, solve with the rules asked for
+	justify_t *const justify = solver->justify;
+	solver->justify = NULL;
+
+	// packing walls alone is just a conversion
+	job->step_count = 0;
+	job->status = SOLVE_GIVEN_UP;
+	if (!batch->options.pack_path || batch->options.pack_flags != 0) {
+		job->step_count = solve(solver, board, &job->status);
+	}
+
+	memset(&job->search, 0, sizeof(search_result_t));
+	if (batch->options.count) {
+		if (job->status == SOLVE_SOLVED) {
+			job->search.solution_count = 1;
+			job->search.is_exhausted = true;
+		} else {
+			reset_to_boundary(board);
+			count_solutions(solver, board, batch->options.solution_cap, NULL, &job->search);
+		}
+	}
+	solver->justify = justify;
+}
+
+static
+void write_job(batch_t *batch, job_t const *job)
+{
+	if (batch->options.pack_path) {
+		write_corpus_board(&batch->pack, &job->board, job->status, job->step_count);
+	} else {
+		printf("%s\t%u\t%u\t%u\t%s\t%u\t%u", job->source, job->index, job->board.width, job->board.height, result_name(job->status), job->step_count, job->removed_count);
+		if (batch->options.count) {
+			printf("\t%u%s", job->search.solution_count, job->search.is_exhausted ? "" : "+");
+		}
+		putchar('\n');
+	}
+
+	++batch->puzzle_count;
+	if (job->status == SOLVE_SOLVED) {
+		++batch->solved_count;
+	} else if (job->status == SOLVE_CONTRADICTION) {
+		++batch->contradiction_count;
+	}
+}
+
+static
+job_t *take_job(batch_t *batch, uint worker_index)
+{
+	// own deque first, oldest job
+	worker_t *const self = batch->workers + worker_index;
+	job_t *job = NULL;
+	pthread_mutex_lock(&self->lock);
+	if (self->count > 0) {
+		job = self->jobs[self->head];
+		self->head = (self->head + 1) % batch->window;
+		--self->count;
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	// otherwise steal the newest job from another worker
+	for (uint i = 1; !job && i < batch->worker_count; ++i) {
+		worker_t *const victim = batch->workers + (worker_index + i) % batch->worker_count;
+		pthread_mutex_lock(&victim->lock);
+		if (victim->count > 0) {
+			--victim->count;
+			job = victim->jobs[(victim->head + victim->count) % batch->window];
+		}
+		pthread_mutex_unlock(&victim->lock);
+	}
+	return job;
+}
+
+static
+void *worker_main(void *arg)
+{
+	worker_t *const worker = (worker_t *)arg;
+	batch_t *const batch = worker->batch;
+	for (;;) {
+		// reserve one queued job, it is then guaranteed to be found in some deque
+		pthread_mutex_lock(&batch->lock);
+		while (batch->queued_count == 0 && !batch->is_reading_done) {
+			pthread_cond_wait(&batch->job_ready, &batch->lock);
+		}
+		bool const is_finished = (batch->queued_count == 0);
+		if (!is_finished) {
+			--batch->queued_count;
+		}
+		pthread_mutex_unlock(&batch->lock);
+		if (is_finished) {
+			break;
+		}
+
+		job_t *job = NULL;
+		while (!job) {
+			job = take_job(batch, worker->index);
+		}
+		solve_job(worker, job);
+
+		pthread_mutex_lock(&batch->lock);
+		job->is_done = true;
+		pthread_cond_broadcast(&batch->job_done);
+		pthread_mutex_unlock(&batch->lock);
+	}
+	return NULL;
+}
+
+static
+job_t *alloc_job(batch_t *batch)
+{
+	pthread_mutex_lock(&batch->lock);
+	while (!batch->free_jobs) {
+		pthread_cond_wait(&batch->job_free, &batch->lock);
+	}
+	job_t *const job = batch->free_jobs;
+	batch->free_jobs = job->next;
+	pthread_mutex_unlock(&batch->lock);
+	return job;
+}
+
+static
+void submit_job(batch_t *batch, job_t *job)
+{
+	pthread_mutex_lock(&batch->lock);
+	job->seq = batch->next_seq++;
+	job->is_done = false;
+	batch->slots[job->seq % batch->window] = job;
+	pthread_mutex_unlock(&batch->lock);
+
+	// deal jobs round robin, idle workers steal to even out the load
+	worker_t *const worker = batch->workers + batch->next_worker;
+	batch->next_worker = (batch->next_worker + 1) % batch->worker_count;
+	pthread_mutex_lock(&worker->lock);
+	worker->jobs[(worker->head + worker->count) % batch->window] = job;
+	++worker->count;
+	pthread_mutex_unlock(&worker->lock);
+
+	pthread_mutex_lock(&batch->lock);
+	++batch->queued_count;
+	pthread_cond_signal(&batch->job_ready);
+	pthread_mutex_unlock(&batch->lock);
+}
+
+static
+char const *add_source(batch_t *batch, char const *name)
+{
+	batch->sources = (char **)realloc(batch->sources, (batch->source_count + 1)*sizeof(char *));
+	char *const source = strdup(name);
+	batch->sources[batch->source_count++] = source;
+	return source;
+}
+
+static
+void release_job(batch_t *batch, job_t *job)
+{
+	pthread_mutex_lock(&batch->lock);
+	job->next = batch->free_jobs;
+	batch->free_jobs = job;
+	pthread_mutex_unlock(&batch->lock);
+}
+
+static
+void dispatch_job(batch_t *batch, job_t *job)
+{
+	// without worker threads, solve and write in place
+	if (batch->worker_count == 0) {
+		job->seq = batch->next_seq++;
+		solve_job(batch->workers, job);
+		write_job(batch, job);
+		job->next = batch->free_jobs;
+		batch->free_jobs = job;
+	} else {
+		submit_job(batch, job);
+	}
+}
+
+static
+bool batch_stream(batch_t *batch, text_input_t *input, char const *name)
+{
+	char const *const source = add_source(batch, name);
+	for (uint index = 0; skip_to_board(input); ++index) {
+		job_t *const job = alloc_job(batch);
+		if (!scan_next_board(&job->board, input)) {
+			fprintf(stderr, "\n%s: failed to read puzzle %u\n", name, index);
+			release_job(batch, job);
+			return false;
+		}
+		job->source = source;
+		job->index = index;
+		dispatch_job(batch, job);
+	}
+	return true;
+}
+
+// puzzles are unpacked straight from the mapped corpus into the job boards
+static
+bool batch_corpus(batch_t *batch, char const *path)
+{
+	corpus_t corpus;
+	if (!open_corpus(&corpus, path)) {
+		return false;
+	}
+	char const *const source = add_source(batch, path);
+	bool result = true;
+	for (uint index = 0; index < corpus.puzzle_count; ++index) {
+		job_t *const job = alloc_job(batch);
+		if (!read_corpus_board(&corpus, index, &job->board, NULL, NULL)) {
+			fprintf(stderr, "\n%s: failed to read puzzle %u\n", path, index);
+			release_job(batch, job);
+			result = false;
+			break;
+		}
+		job->source = source;
+		job->index = index;
+		dispatch_job(batch, job);
+	}
+	close_corpus(&corpus);
+	return result;
+}
+
+static
+int compare_names(void const *a, void const *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static
+bool batch_directory(batch_t *batch, char const *path);
+
+// a list file has no board lines, just one path per line
+static
+bool is_list_file(text_input_t const *input)
+{
+	char const *p = input->data;
+	char const *const end = input->data + input->size;
+	while (p < end && (*p == '#' || *p == '\r' || *p == '\n')) {
+		char const *const next = (char const *)memchr(p, '\n', (size_t)(end - p));
+		p = next ? (next + 1) : end;
+	}
+	for (; p < end && *p != '\n'; ++p) {
+		if (*p == '+' || *p == '|') {
+			return false;
+		}
+	}
+	return true;
+}
+
+// reads from stdin if path is NULL
+static
+bool batch_path(batch_t *batch, char const *path)
+{
+	struct stat st;
+	if (path && stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+		return batch_directory(batch, path);
+	}
+
+	text_input_t input;
+	if (!open_text_input(&input, path)) {
+		return false;
+	}
+
+	// only regular files can list paths or be a binary corpus, stdin and pipes are always puzzle streams
+	bool result = true;
+	if (input.is_mapped && is_corpus_data(input.data, input.size)) {
+		close_text_input(&input);
+		return batch_corpus(batch, path);
+	}
+	if (input.is_mapped && is_list_file(&input)) {
+		char const *line;
+		size_t length;
+		while (result && read_line(&input, &line, &length)) {
+			while (length > 0 && line[length - 1] == '\r') {
+				--length;
+			}
+			if (length > 0 && *line != '#') {
+				char *const name = strndup(line, length);
+				result = batch_path(batch, name);
+				free(name);
+			}
+		}
+	} else {
+		result = batch_stream(batch, &input, path ? path : "stdin");
+	}
+	close_text_input(&input);
+	return result;
+}
+
+static
+bool batch_directory(batch_t *batch, char const *path)
+{
+	DIR *const dir = opendir(path);
+	if (!dir) {
+		fprintf(stderr, "failed to open directory \"%s\"!\n", path);
+		return false;
+	}
+
+	// collect puzzle files in name order so that output is stable
+	uint name_count = 0;
+	uint name_capacity = 0;
+	char **names = NULL;
+	for (struct dirent const *entry; (entry = readdir(dir)) != NULL;) {
+		size_t const len = strlen(entry->d_name);
+		bool const is_text = (len >= 3 && strcmp(entry->d_name + len - 3, ".az") == 0);
+		bool const is_corpus = (len >= 4 && strcmp(entry->d_name + len - 4, ".azb") == 0);
+		if (!is_text && !is_corpus) {
+			continue;
+		}
+		if (name_count == name_capacity) {
+			name_capacity = name_capacity ? 2*name_capacity : 64;
+			names = (char **)realloc(names, name_capacity*sizeof(char *));
+		}
+		names[name_count] = (char *)malloc(strlen(path) + len + 2);
+		sprintf(names[name_count], "%s/%s", path, entry->d_name);
+		++name_count;
+	}
+	closedir(dir);
+	qsort(names, name_count, sizeof(char *), compare_names);
+
+	bool result = true;
+	for (uint i = 0; i < name_count; ++i) {
+		if (result) {
+			result = batch_path(batch, names[i]);
+		}
+		free(names[i]);
+	}
+	free(names);
+	return result;
+}
+
+typedef struct
+{
+	batch_t *batch;
+	char const *path;
+} reader_args_t;
+
+static
+void *reader_main(void *arg)
+{
+	reader_args_t const *const args = (reader_args_t const *)arg;
+	batch_t *const batch = args->batch;
+	bool const result = batch_path(batch, args->path);
+
+	pthread_mutex_lock(&batch->lock);
+	batch->result = result;
+	batch->is_reading_done = true;
+	pthread_cond_broadcast(&batch->job_ready);
+	pthread_cond_broadcast(&batch->job_done);
+	pthread_mutex_unlock(&batch->lock);
+	return NULL;
+}
+
+// write results in input order as they complete, recycling each job for the reader
+static
+void write_results(batch_t *batch)
+{
+	for (uint seq = 0;; ++seq) {
+		pthread_mutex_lock(&batch->lock);
+		job_t *job;
+		for (;;) {
+			job = batch->slots[seq % batch->window];
+			bool const is_ready = (seq < batch->next_seq && job->is_done);
+			if (is_ready || (batch->is_reading_done && seq == batch->next_seq)) {
+				break;
+			}
+			pthread_cond_wait(&batch->job_done, &batch->lock);
+		}
+		pthread_mutex_unlock(&batch->lock);
+		if (seq == batch->next_seq) {
+			break;
+		}
+
+		write_job(batch, job);
+
+		pthread_mutex_lock(&batch->lock);
+		job->next = batch->free_jobs;
+		batch->free_jobs = job;
+		pthread_cond_signal(&batch->job_free);
+		pthread_mutex_unlock(&batch->lock);
+	}
+}
+
+static
+void init_worker(worker_t *worker, batch_t *batch, uint index)
+{
+	memset(worker, 0, sizeof(worker_t));
+	worker->batch = batch;
+	worker->index = index;
+	worker->solver.verbose = batch->options.verbose;
+	worker->solver.bitboard = batch->options.use_bitboard ? &worker->bitboard : NULL;
+	worker->solver.worklist = batch->options.event_driven ? &worker->worklist : NULL;
+	worker->solver.justify = (batch->options.incremental && batch->options.try_removing_edges) ? &worker->justify : NULL;
+	worker->solver.schedule = batch->options.adaptive ? &worker->schedule : NULL;
+	if (batch->options.stats) {
+		init_stats(&worker->stats);
+		worker->solver.stats = &worker->stats;
+	}
+	worker->jobs = (job_t **)malloc(batch->window*sizeof(job_t *));
+	pthread_mutex_init(&worker->lock, NULL);
+}
+
+static
+void free_worker(worker_t *worker)
+{
+	if (worker->solver.stats) {
+		merge_stats(worker->batch->options.stats, &worker->stats);
+		free_stats(&worker->stats);
+	}
+	if (worker->solver.capacity_width != 0) {
+		if (worker->solver.bitboard) {
+			free_bitboard(&worker->bitboard);
+		}
+		if (worker->solver.worklist) {
+			free_worklist(&worker->worklist);
+		}
+		if (worker->solver.justify) {
+			free_justify(&worker->justify);
+		}
+		if (worker->solver.schedule) {
+			free_schedule(&worker->schedule);
+		}
+		free_solver(&worker->solver);
+	}
+	pthread_mutex_destroy(&worker->lock);
+	free(worker->jobs);
+}
+
+// solve every puzzle from a directory of .az files, a file listing paths, or a multi-puzzle stream (stdin if no path)
+int run_batch(char const *path, batch_options_t const *options)
+{
+	batch_t batch;
+	memset(&batch, 0, sizeof(batch_t));
+	batch.options = *options;
+	if (options->pack_path && !open_corpus_writer(&batch.pack, options->pack_path, options->pack_flags)) {
+		return -1;
+	}
+
+	// verbose output would interleave between workers, so solve in place on this thread
+	uint const thread_count = options->verbose ? 1 : max(options->thread_count, 1);
+	batch.worker_count = (thread_count > 1) ? thread_count : 0;
+	batch.window = 4*thread_count;
+
+	batch.job_storage = (job_t *)calloc(batch.window, sizeof(job_t));
+	for (uint i = 0; i < batch.window; ++i) {
+		batch.job_storage[i].next = batch.free_jobs;
+		batch.free_jobs = batch.job_storage + i;
+	}
+	batch.slots = (job_t **)calloc(batch.window, sizeof(job_t *));
+	batch.workers = (worker_t *)malloc(max(batch.worker_count, 1)*sizeof(worker_t));
+	for (uint i = 0; i < max(batch.worker_count, 1); ++i) {
+		init_worker(batch.workers + i, &batch, i);
+	}
+	pthread_mutex_init(&batch.lock, NULL);
+	pthread_cond_init(&batch.job_ready, NULL);
+	pthread_cond_init(&batch.job_done, NULL);
+	pthread_cond_init(&batch.job_free, NULL);
+
+	if (!options->pack_path) {
+		printf("# source\tindex\twidth\theight\tresult\tsteps\tremoved%s\n", options->count ? "\tsolutions" : "");
+	}
+	bool result;
+	if (batch.worker_count == 0) {
+		result = batch_path(&batch, path);
+	} else {
+		for (uint i = 0; i < batch.worker_count; ++i) {
+			pthread_create(&batch.workers[i].thread, NULL, worker_main, batch.workers + i);
+		}
+		reader_args_t args = { &batch, path };
+		pthread_t reader;
+		pthread_create(&reader, NULL, reader_main, &args);
+		write_results(&batch);
+		pthread_join(reader, NULL);
+		for (uint i = 0; i < batch.worker_count; ++i) {
+			pthread_join(batch.workers[i].thread, NULL);
+		}
+		result = batch.result;
+	}
+	fflush(stdout);
+	if (options->pack_path) {
+		result = close_corpus_writer(&batch.pack) && result;
+	}
+	if (options->pack_path && options->pack_flags == 0) {
+		fprintf(stderr, "%u puzzles packed\n", batch.puzzle_count);
+	} else {
+		fprintf(stderr, "%u puzzles, %u solved, %u contradictions\n", batch.puzzle_count, batch.solved_count, batch.contradiction_count);
+	}
+
+	pthread_cond_destroy(&batch.job_free);
+	pthread_cond_destroy(&batch.job_done);
+	pthread_cond_destroy(&batch.job_ready);
+	pthread_mutex_destroy(&batch.lock);
+	for (uint i = 0; i < max(batch.worker_count, 1); ++i) {
+		free_worker(batch.workers + i);
+	}
+	free(batch.workers);
+	for (uint i = 0; i < batch.window; ++i) {
+		free_board(&batch.job_storage[i].board);
+	}
+	free(batch.job_storage);
+	free(batch.slots);
+	for (uint i = 0; i < batch.source_count; ++i) {
+		free(batch.sources[i]);
+	}
+	free(batch.sources);
+	return result ? 0 : -1;
+}
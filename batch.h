@@ -0,0 +1,22 @@
+#pragma once
+
+#include "board.h"
+
+typedef struct
+{
+	bool try_removing_edges;
+	bool use_bitboard;
+	bool event_driven;
+	bool incremental;		// harden with justify_t, see justify.h
+	bool adaptive;			// order rules with schedule_t, see schedule.h
+	bool verbose;
+	uint thread_count;
+	unsigned long seed;		// harden of puzzle n is seeded with seed + n
+	bool count;				// search for solutions when the rules give up
+	uint solution_cap;
+	stats_t *stats;			// if not NULL, counters from every worker are added here
+	char const *pack_path;	// if not NULL, puzzles are written to this corpus instead of a results table
+	uint pack_flags;		// CORPUS_SOLUTION and CORPUS_STATS solve each puzzle before it is packed
+} batch_options_t;
+
+int run_batch(char const *path, batch_options_t const *options);
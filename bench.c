@@ -0,0 +1,280 @@
+#define _POSIX_C_SOURCE 200809L
+#include "solver.h"
+#include "bitboard.h"
+#include "generate.h"
+#include "kernels.h"
+#include "io.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// benchmark driver: times solve on the puzzle corpus and synthetic boards, and harden as boards grow
+// output is one tab-separated record per case so runs can be compared by script
+
+typedef struct
+{
+	uint iteration_count;	// timed runs per case
+	double max_seconds;		// stop repeating a case after this long, at least one run is always made
+	double max_sweep_seconds;	// stop a sweep once a single run takes longer than this
+	uint max_solve_size;	// largest synthetic board for the solve sweep
+	uint max_harden_size;	// largest synthetic board for the harden sweep
+	uint removal_percent;	// share of walls knocked out of synthetic boards for the solve sweep
+	unsigned long seed;
+	bool use_bitboard;
+	bool event_driven;
+	cell_kernels_t const *kernels;	// row kernels for the single cell and loop rules
+} bench_options_t;
+
+typedef struct
+{
+	solver_t solver;
+	bitboard_t bitboard;
+	worklist_t worklist;
+	board_t test;
+	uint64_t *times;		// ns per run
+} bench_t;
+
+static
+uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static
+int compare_times(void const *a, void const *b)
+{
+	uint64_t const x = *(uint64_t const *)a;
+	uint64_t const y = *(uint64_t const *)b;
+	return (x > y) - (x < y);
+}
+
+static
+void prepare(bench_t *bench, board_t const *board)
+{
+	free_board(&bench->test);
+	copy_board(&bench->test, board);
+	reserve_solver(&bench->solver, board);
+}
+
+static
+uint64_t report(char const *kind, char const *name, board_t const *board, bench_t *bench, uint run_count, uint step_count, uint work_count, char const *result)
+{
+	qsort(bench->times, run_count, sizeof(uint64_t), compare_times);
+	uint64_t const median = bench->times[run_count/2];
+	uint64_t const p99 = bench->times[min((run_count*99 + 99)/100, run_count) - 1];
+	uint64_t const per_step = (step_count > 0) ? median/step_count : 0;
+	printf("%s\t%s\t%u\t%u\t%u\t%llu\t%llu\t%u\t%llu\t%u\t%s\n", kind, name, board->width, board->height, run_count,
+		(unsigned long long)median, (unsigned long long)p99, step_count, (unsigned long long)per_step, work_count, result);
+	fflush(stdout);
+	return median;
+}
+
+static
+char const *result_name(solve_status_t status)
+{
+	switch (status) {
+		case SOLVE_SOLVED:			return "solved";
+		case SOLVE_CONTRADICTION:	return "contradiction";
+		default:					return "given_up";
+	}
+}
+
+// solve the same puzzle repeatedly from its initial conditions
+static
+uint64_t bench_solve(bench_t *bench, bench_options_t const *options, char const *kind, char const *name, board_t const *board)
+{
+	prepare(bench, board);
+	uint64_t const start = now_ns();
+	uint run_count = 0;
+	uint step_count = 0;
+	solve_status_t status = SOLVE_GIVEN_UP;
+	while (run_count < options->iteration_count && (run_count == 0 || (now_ns() - start) < options->max_seconds*1e9)) {
+		copy_board_edges(&bench->test, board);
+		reset_to_boundary(&bench->test);
+		uint64_t const t0 = now_ns();
+		step_count = solve(&bench->solver, &bench->test, &status);
+		bench->times[run_count++] = now_ns() - t0;
+	}
+	return report(kind, name, board, bench, run_count, step_count, 0, result_name(status));
+}
+
+// harden the same puzzle repeatedly with the same seed
+static
+uint64_t bench_harden(bench_t *bench, bench_options_t const *options, char const *name, board_t const *board)
+{
+	prepare(bench, board);
+	uint64_t const start = now_ns();
+	uint run_count = 0;
+	uint removed_count = 0;
+	while (run_count < options->iteration_count && (run_count == 0 || (now_ns() - start) < options->max_seconds*1e9)) {
+		copy_board_edges(&bench->test, board);
+		reset_to_boundary(&bench->test);
+		mt_state_t rng;
+		init_genrand(&rng, options->seed);
+		uint64_t const t0 = now_ns();
+		removed_count = harden(&bench->solver, &bench->test, &rng);
+		bench->times[run_count++] = now_ns() - t0;
+	}
+	return report("harden", name, board, bench, run_count, 0, removed_count, "hardened");
+}
+
+// generated puzzle of the given size with a share of its walls knocked out at random
+// no solve is needed to build it, so it may not be unique, but the work it causes is repeatable
+static
+void synthetic_board(board_t *board, uint size, uint removal_percent, unsigned long seed)
+{
+	board->width = size;
+	board->height = size;
+	board->edge_h = (uint *)malloc(size*(size + 1)*sizeof(uint));
+	board->edge_v = (uint *)malloc((size + 1)*size*sizeof(uint));
+	uint *const path = (uint *)malloc(2*size*size*sizeof(uint));
+	mt_state_t rng;
+	init_genrand(&rng, seed + size);
+	generate_walled_board(board, &rng, path);
+	for (uint i = 0; i < size*(size + 1); ++i) {
+		if (genrand_int32(&rng) % 100 < removal_percent) {
+			board->edge_h[i] = 0;
+		}
+	}
+	for (uint i = 0; i < (size + 1)*size; ++i) {
+		if (genrand_int32(&rng) % 100 < removal_percent) {
+			board->edge_v[i] = 0;
+		}
+	}
+	free(path);
+}
+
+static
+bool load_board(board_t *board, char const *filename)
+{
+	text_input_t input;
+	if (!open_text_input(&input, filename)) {
+		return false;
+	}
+	bool const result = scan_board(board, &input);
+	close_text_input(&input);
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	bench_options_t options;
+	memset(&options, 0, sizeof(bench_options_t));
+	options.iteration_count = 21;
+	options.max_seconds = 2.0;
+	options.max_sweep_seconds = 10.0;
+	options.max_solve_size = 200;
+	options.max_harden_size = 200;
+	options.removal_percent = 20;
+	options.seed = 5489;
+	options.kernels = default_cell_kernels();
+
+	char const *default_corpus[] = { "ball_room_example.az", "advanced_77.az", "advanced_97.az", "hand_made.az" };
+	char const **corpus = default_corpus;
+	uint corpus_count = sizeof(default_corpus)/sizeof(default_corpus[0]);
+	char const **files = (char const **)malloc(argc*sizeof(char const *));
+	uint file_count = 0;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+			options.iteration_count = max((uint)strtoul(argv[++i], NULL, 10), 1);
+		} else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			options.max_seconds = strtod(argv[++i], NULL);
+		} else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+			options.max_sweep_seconds = strtod(argv[++i], NULL);
+		} else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+			options.max_solve_size = (uint)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) {
+			options.max_harden_size = (uint)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			options.removal_percent = min((uint)strtoul(argv[++i], NULL, 10), 100);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			options.seed = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-b") == 0) {
+			options.use_bitboard = true;
+		} else if (strcmp(argv[i], "-e") == 0) {
+			options.event_driven = true;
+		} else if (strcmp(argv[i], "-K") == 0 && i + 1 < argc) {
+			options.kernels = find_cell_kernels(argv[++i]);
+			if (!options.kernels) {
+				fprintf(stderr, "kernels \"%s\" are not available!\n", argv[i]);
+				return -1;
+			}
+		} else if (argv[i][0] != '-') {
+			files[file_count++] = argv[i];
+		} else {
+			fprintf(stderr, "unknown option \"%s\"!\n", argv[i]);
+			return -1;
+		}
+	}
+	if (file_count > 0) {
+		corpus = files;
+		corpus_count = file_count;
+	}
+
+	bench_t bench;
+	memset(&bench, 0, sizeof(bench_t));
+	bench.solver.bitboard = options.use_bitboard ? &bench.bitboard : NULL;
+	bench.solver.worklist = options.event_driven ? &bench.worklist : NULL;
+	bench.solver.kernels = options.kernels;
+	bench.times = (uint64_t *)malloc(options.iteration_count*sizeof(uint64_t));
+
+	printf("# cell kernels: %s\n", options.kernels->name);
+	printf("# kind\tname\twidth\theight\truns\tmedian_ns\tp99_ns\tsteps\tns_per_step\tremoved\tresult\n");
+
+	// corpus puzzles
+	for (uint i = 0; i < corpus_count; ++i) {
+		board_t board;
+		if (!load_board(&board, corpus[i])) {
+			return -1;
+		}
+		bench_solve(&bench, &options, "corpus", corpus[i], &board);
+		free_board(&board);
+	}
+
+	// solve scaling
+	uint const sizes[] = { 5, 10, 15, 20, 30, 40, 50, 75, 100, 150, 200 };
+	for (uint i = 0; i < sizeof(sizes)/sizeof(sizes[0]) && sizes[i] <= options.max_solve_size; ++i) {
+		uint const size = sizes[i];
+		board_t board;
+		synthetic_board(&board, size, options.removal_percent, options.seed);
+		char name[32];
+		sprintf(name, "synthetic_%ux%u", size, size);
+		uint64_t const median = bench_solve(&bench, &options, "solve", name, &board);
+		free_board(&board);
+		if (median > options.max_sweep_seconds*1e9) {
+			printf("# solve sweep stopped after %s\n", name);
+			break;
+		}
+	}
+
+	// harden scaling, starting from the fully walled board
+	for (uint i = 0; i < sizeof(sizes)/sizeof(sizes[0]) && sizes[i] <= options.max_harden_size; ++i) {
+		uint const size = sizes[i];
+		board_t board;
+		synthetic_board(&board, size, 0, options.seed);
+		char name[32];
+		sprintf(name, "synthetic_%ux%u", size, size);
+		uint64_t const median = bench_harden(&bench, &options, name, &board);
+		free_board(&board);
+		if (median > options.max_sweep_seconds*1e9) {
+			printf("# harden sweep stopped after %s\n", name);
+			break;
+		}
+	}
+
+	free(bench.times);
+	free_board(&bench.test);
+	if (bench.solver.capacity_width != 0) {
+		if (bench.solver.bitboard) {
+			free_bitboard(&bench.bitboard);
+		}
+		if (bench.solver.worklist) {
+			free_worklist(&bench.worklist);
+		}
+		free_solver(&bench.solver);
+	}
+	free(files);
+	return 0;
+}
@@ -0,0 +1,261 @@
+#include "bitboard.h"
+#include "solver.h"
+#include "io.h"
+#include <stdlib.h>
+#include <memory.h>
+
+// false if the planes could not be allocated
+bool init_bitboard(bitboard_t *bitboard, board_t const *board)
+{
+	uint const height = board->height;
+	uint const stride = (board->width + 64)/64;
+	uint const count_h = stride*(height + 1);
+	uint const count_v = stride*height;
+
+	memset(bitboard, 0, sizeof(bitboard_t));
+	bitboard->stride = stride;
+	bitboard->barrier_h = (uint64_t *)malloc((2*count_h + 2*count_v)*sizeof(uint64_t));
+	bitboard->path_h = bitboard->barrier_h + count_h;
+	bitboard->barrier_v = bitboard->path_h + count_h;
+	bitboard->path_v = bitboard->barrier_v + count_v;
+	return bitboard->barrier_h != NULL;
+}
+
+void free_bitboard(bitboard_t *bitboard)
+{
+	free(bitboard->barrier_h);
+	memset(bitboard, 0, sizeof(bitboard_t));
+}
+
+static
+void pack_row(uint64_t *barrier, uint64_t *path, uint const *edges, uint count, uint stride)
+{
+	uint x = 0;
+	for (uint i = 0; i < stride; ++i) {
+		uint64_t b = 0;
+		uint64_t p = 0;
+		for (uint j = 0; j < 64 && x < count; ++j, ++x) {
+			uint const e = edges[x];
+			b |= (uint64_t)((e & EDGE_BARRIER) != 0) << j;
+			p |= (uint64_t)((e & EDGE_PATH) != 0) << j;
+		}
+		barrier[i] = b;
+		path[i] = p;
+	}
+}
+
+void pack_bitboard(bitboard_t const *bitboard, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const stride = bitboard->stride;
+	for (uint y = 0; y <= height; ++y) {
+		uint const k = y*stride;
+		pack_row(bitboard->barrier_h + k, bitboard->path_h + k, board->edge_h + y*width, width, stride);
+	}
+	for (uint y = 0; y < height; ++y) {
+		uint const k = y*stride;
+		pack_row(bitboard->barrier_v + k, bitboard->path_v + k, board->edge_v + y*(width + 1), width + 1, stride);
+	}
+}
+
+void set_bitboard_edge(bitboard_t const *bitboard, board_t const *board, uint k, uint bits)
+{
+	uint const width = board->width;
+	uint const edge_count_h = width*(board->height + 1);
+	uint64_t *barrier = bitboard->barrier_h;
+	uint64_t *path = bitboard->path_h;
+	uint row_length = width;
+	if (k >= edge_count_h) {
+		barrier = bitboard->barrier_v;
+		path = bitboard->path_v;
+		row_length = width + 1;
+		k -= edge_count_h;
+	}
+	uint const x = k % row_length;
+	uint const i = (k/row_length)*bitboard->stride + x/64;
+	uint64_t const mask = 1ULL << (x % 64);
+	if (bits & EDGE_BARRIER) {
+		barrier[i] |= mask;
+	}
+	if (bits & EDGE_PATH) {
+		path[i] |= mask;
+	}
+}
+
+// bit-sliced counts of 4 one-bit inputs, for 64 cells at once
+static inline
+uint64_t count_is_2(uint64_t a, uint64_t b, uint64_t c, uint64_t d)
+{
+	uint64_t const x1 = a ^ b;
+	uint64_t const x2 = c ^ d;
+	return ~(x1 ^ x2) & ((a & b) ^ (c & d) ^ (x1 & x2));
+}
+
+static inline
+uint64_t count_at_least_2(uint64_t a, uint64_t b, uint64_t c, uint64_t d)
+{
+	return (a & b) | (c & d) | ((a ^ b) & (c ^ d));
+}
+
+static inline
+uint64_t count_at_least_3(uint64_t a, uint64_t b, uint64_t c, uint64_t d)
+{
+	return (a & b & (c | d)) | (c & d & (a | b));
+}
+
+// east edges of the cells in word i are the vertical edges shifted down by one
+static inline
+uint64_t east_of(uint64_t const *row, uint i, uint stride)
+{
+	uint64_t const next = (i + 1 < stride) ? row[i + 1] : 0;
+	return (row[i] >> 1) | (next << 63);
+}
+
+// cells of word i in row y that would fire as the planes stand
+static
+void find_single_cells(bitboard_t const *bitboard, uint y, uint i, uint64_t *make_path, uint64_t *make_barrier)
+{
+	uint const stride = bitboard->stride;
+	uint const k = y*stride + i;
+
+	// per-edge planes in NSWE order to match check_single_cells
+	uint64_t const barrier[4] = {
+		bitboard->barrier_h[k],
+		bitboard->barrier_h[k + stride],
+		bitboard->barrier_v[k],
+		east_of(bitboard->barrier_v + y*stride, i, stride)
+	};
+	uint64_t const path[4] = {
+		bitboard->path_h[k],
+		bitboard->path_h[k + stride],
+		bitboard->path_v[k],
+		east_of(bitboard->path_v + y*stride, i, stride)
+	};
+
+	*make_path = count_is_2(~barrier[0], ~barrier[1], ~barrier[2], ~barrier[3])
+		& ~count_at_least_2(path[0], path[1], path[2], path[3]);
+	*make_barrier = count_is_2(path[0], path[1], path[2], path[3])
+		& count_at_least_3(~barrier[0], ~barrier[1], ~barrier[2], ~barrier[3]);
+}
+
+// the single cell rule for one cell as the planes stand, returns EDGE_PATH, EDGE_BARRIER or 0
+static
+uint single_cell_rule(bitboard_t const *bitboard, uint x, uint y)
+{
+	uint const stride = bitboard->stride;
+	uint const i = x/64;
+	uint const j = x % 64;
+	uint const e = (x + 1)/64;
+	uint const f = (x + 1) % 64;
+	uint const barrier =
+		(uint)((bitboard->barrier_h[y*stride + i] >> j) & 1) +
+		(uint)((bitboard->barrier_h[(y + 1)*stride + i] >> j) & 1) +
+		(uint)((bitboard->barrier_v[y*stride + i] >> j) & 1) +
+		(uint)((bitboard->barrier_v[y*stride + e] >> f) & 1);
+	uint const path =
+		(uint)((bitboard->path_h[y*stride + i] >> j) & 1) +
+		(uint)((bitboard->path_h[(y + 1)*stride + i] >> j) & 1) +
+		(uint)((bitboard->path_v[y*stride + i] >> j) & 1) +
+		(uint)((bitboard->path_v[y*stride + e] >> f) & 1);
+	if (barrier == 2 && path < 2) {
+		return EDGE_PATH;
+	}
+	if (path == 2 && barrier < 2) {
+		return EDGE_BARRIER;
+	}
+	return 0;
+}
+
+// sets the edges of one cell, the planes follow through decide_edge
+static
+void fire_cell(solver_t const *solver, board_t const *board, uint x, uint y, bool is_path_cell)
+{
+	uint const width = board->width;
+	uint const edge_count_h = width*(board->height + 1);
+	bitboard_t const *const bitboard = solver->bitboard;
+	uint const stride = bitboard->stride;
+
+	uint ids[4];
+	ids[0] = y*width + x;
+	ids[1] = ids[0] + width;
+	ids[2] = edge_count_h + y*(width + 1) + x;
+	ids[3] = ids[2] + 1;
+	uint64_t const *const barrier[4] = {
+		bitboard->barrier_h + y*stride,
+		bitboard->barrier_h + (y + 1)*stride,
+		bitboard->barrier_v + y*stride,
+		bitboard->barrier_v + y*stride
+	};
+	uint64_t const *const path[4] = {
+		bitboard->path_h + y*stride,
+		bitboard->path_h + (y + 1)*stride,
+		bitboard->path_v + y*stride,
+		bitboard->path_v + y*stride
+	};
+	uint const bit[4] = { x, x, x, x + 1 };
+
+	for (uint n = 0; n < 4; ++n) {
+		uint const i = bit[n]/64;
+		uint64_t const mask = 1ULL << (bit[n] % 64);
+		bool const is_available = (barrier[n][i] & mask) == 0;
+		bool const is_path = (path[n][i] & mask) != 0;
+		if (is_path_cell && is_available) {
+			decide_edge(solver, board, ids[n], EDGE_PATH);
+		} else if (!is_path_cell && !is_path) {
+			decide_edge(solver, board, ids[n], EDGE_BARRIER);
+		}
+	}
+}
+
+// the planes are packed when solve starts and follow every rule's writes after that
+bool check_single_cells_bitboard(solver_t const *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint *const cells = solver->tmp1;
+	bitboard_t const *const bitboard = solver->bitboard;
+	uint const stride = bitboard->stride;
+
+	// highlights are only drawn when verbose
+	if (solver->verbose) {
+		memset(cells, 0, width*height*sizeof(uint));
+	}
+
+	// a cell that fires can only change the west edge of the next cell in the word, so only that
+	// one is checked again, giving the same result as checking every cell in order
+	bool changed = false;
+	for (uint y = 0; y < height; ++y)
+	for (uint i = 0; i < stride; ++i) {
+		uint const cell_count = min(width - min(width, 64*i), 64);
+		uint64_t const valid = (cell_count == 64) ? ~0ULL : ((1ULL << cell_count) - 1);
+		uint64_t make_path, make_barrier;
+		find_single_cells(bitboard, y, i, &make_path, &make_barrier);
+		uint64_t fired = (make_path | make_barrier) & valid;
+		while (fired != 0) {
+			uint const j = (uint)__builtin_ctzll(fired);
+			fired &= fired - 1;
+
+			uint const x = 64*i + j;
+			fire_cell(solver, board, x, y, ((make_path >> j) & 1) != 0);
+			if (solver->verbose) {
+				cells[y*width + x] = 1;
+			}
+			changed = true;
+
+			if (j + 1 < cell_count) {
+				uint64_t const next = 2ULL << j;
+				uint const rule = single_cell_rule(bitboard, x + 1, y);
+				fired = (rule != 0) ? (fired | next) : (fired & ~next);
+				make_path = (rule == EDGE_PATH) ? (make_path | next) : (make_path & ~next);
+			}
+		}
+	}
+
+	if (changed && solver->verbose) {
+		fputs("\nsingle cells:\n", stdout);
+		print_board(solver, board, EDGE_ALL | EDGE_HIGHLIGHT | EDGE_NEW);
+	}
+
+	return changed;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "board.h"
+
+bool init_bitboard(bitboard_t *bitboard, board_t const *board);
+void free_bitboard(bitboard_t *bitboard);
+void pack_bitboard(bitboard_t const *bitboard, board_t const *board);
+void set_bitboard_edge(bitboard_t const *bitboard, board_t const *board, uint k, uint bits);
+bool check_single_cells_bitboard(solver_t const *solver, board_t const *board);
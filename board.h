@@ -1,9 +1,24 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
 
 typedef unsigned int uint;
 
+static inline
+uint min(uint a, uint b)
+{
+	return (a < b) ? a : b;
+}
+
+static inline
+uint max(uint a, uint b)
+{
+	return (a > b) ? a : b;
+}
+
 #define EDGE_BOUNDARY		0x01U
 #define EDGE_BARRIER		0x02U
 #define EDGE_PATH			0x04U
@@ -12,6 +27,29 @@ typedef unsigned int uint;
 #define EDGE_HIGHLIGHT		0x08U
 #define EDGE_NEW			0x10U
 
+#define NOT_ON_PATH			(~0U)
+
+// indices are 32-bit, the largest scratch buffer has 4*(width + 1)*(height + 1) entries
+static inline
+bool is_board_size_supported(uint width, uint height)
+{
+	return 4*((uint64_t)width + 1)*((uint64_t)height + 1) <= 0xffffffffULL;
+}
+
+typedef enum
+{
+	STEP_NONE,			// rule made no deductions
+	STEP_CHANGED,		// rule set at least one edge
+	STEP_CONTRADICTION	// board cannot be completed, stop solving
+} step_t;
+
+typedef enum
+{
+	SOLVE_GIVEN_UP,		// no more deductions, board not complete
+	SOLVE_SOLVED,
+	SOLVE_CONTRADICTION
+} solve_status_t;
+
 typedef struct
 {
 	uint width;
@@ -22,9 +60,169 @@ typedef struct
 
 typedef struct
 {
+	uint cell_count[2];		// island cells by checkerboard parity
+	uint available_count[2];	// non-barrier edges leaving the block, by parity of the island cell
+	uint path_count[2];
+} parity_counts_t;
+
+typedef struct
+{
+	uint stride;		// 64-bit words per row of edges: (width + 64)/64
+	uint64_t *barrier_h;	// one bit per edge, (height + 1) rows
+	uint64_t *path_h;
+	uint64_t *barrier_v;	// bit x of row y is edge_v[y*(width + 1) + x], height rows
+	uint64_t *path_v;
+} bitboard_t;
+
+typedef struct
+{
+	uint *cells;		// ring buffer of cells to check: width*height
+	uint *is_queued;	// per cell flag: width*height
+	uint head;
+	uint count;
+	uint generation;	// number of times changes have been collected
+	uint *stamp_h;		// generation in which each edge last changed
+	uint *stamp_v;
+	uint *size_clean;	// per block size, generation of the last sweep with no deductions: (width + 1)*(height + 1)
+	uint dirty_since;	// generation used to build the dirty sums below
+	uint *dirty_sum_h;	// summed-area tables of edges changed since dirty_since, same layout as barrier_sum_h
+	uint *dirty_sum_v;
+	uint *path_parent;	// union-find over cells joined by path edges, NOT_ON_PATH if no path edges: width*height
+	uint *path_size;	// number of cells in the segment, valid for roots
+	uint *path_degree;	// path edges at each cell, exits included: width*height
+	uint *path_ends;	// cells of the segment with one path edge, two per cell, valid for roots, NOT_ON_PATH if unused
+	uint path_count;	// number of path segments
+	uint exit_count;	// number of path edges through the boundary
+	uint exit_cells[2];
+	bool paths_are_simple;	// false once a segment closes or branches, then its ends don't describe it
+	bool loops_scan_all;	// the next loop check looks at the whole board, set by reset_worklist
+	uint *loop_cells;	// cells next to edges that changed since the last loop check: width*height
+	uint *is_loop_queued;	// per cell flag: width*height
+	uint loop_cell_count;
+	uint *loop_stamp;	// per cell, loop_generation when last taken as a loop candidate
+	uint loop_generation;
+	uint *corner_parent;	// union-find over corners joined by barriers, last entry is the boundary: (width + 1)*(height + 1) + 1
+	uint *corner_size;
+	uint *corner_next;	// circular list through the corners of each set
+	uint *partition_edges;	// edges for the partition check to set, vertical edges after all horizontal ones
+	uint partition_edge_count;
+} worklist_t;
+
+typedef enum
+{
+	RULE_SINGLE_CELLS,
+	RULE_LOOPS,
+	RULE_PARTITIONS,
+	RULE_PARITY,
+	RULE_COUNT
+} rule_t;
+
+typedef struct
+{
+	uint64_t call_count;
+	uint64_t success_count;	// calls that set at least one edge
+	uint64_t edge_count;	// edges decided by this rule
+	uint64_t cycle_count;
+} rule_stats_t;
+
+typedef struct
+{
+	rule_stats_t rules[RULE_COUNT];
+	uint64_t solve_count;
+	uint64_t step_count;
+	uint decided_count;		// edges decided since the last rule ended, counted by decide_edge
+	uint max_width;			// largest block size counted below
+	uint max_height;
+	uint64_t *parity_block_counts;	// blocks checked per block size: (max_width + 1)*(max_height + 1)
+	uint64_t parity_cache_hits;	// blocks skipped since the same edges deduced nothing before
+	uint64_t start_cycles;	// for converting cycles to time when printing
+	uint64_t start_ns;
+} stats_t;
+
+typedef struct
+{
+	FILE *fp;
+	uint8_t *shadow;		// edge bits as of the last record, vertical edges after all horizontal ones
+	uint shadow_capacity;
+	uint *changes;			// edges changed since the last record, each once: shadow_capacity
+	uint change_count;
+	uint8_t *buffer;		// records not yet written
+	size_t buffer_count;
+	size_t buffer_capacity;
+} trace_t;
+
+#define NO_CAUSE			(~0U)
+
+typedef struct
+{
+	uint *cause;			// event that decided each edge, NO_CAUSE for walls and undecided edges
+	uint *premise_start;	// first premise of each event: event_count + 1 entries
+	uint *premises;			// edges each event read, vertical edges after all horizontal ones
+	uint premise_count;
+	uint event_count;
+	uint event_capacity;
+	uint premise_capacity;
+} justification_t;
+
+typedef struct
+{
+	uint edge_count_h;		// of the board being recorded
+	uint edge_count;
+	justification_t record;	// deductions of the solve in progress
+	justification_t base;	// deductions of the last board harden kept
+	uint *remap;			// new index of each event kept when retracting: record.event_capacity
+	uint remap_capacity;
+	uint *segment_start;	// path edges grouped by loop check segment index: width*height + 2
+	uint *segment_edges;	// 2*(width + 1)*(height + 1)
+} justify_t;
+
+#define NO_TASK				(~0U)
+
+typedef struct
+{
+	uint64_t cost;			// estimated cycles per call from what it visited, moving average
+	uint64_t yield;			// edges decided per call in 1/256ths, moving average
+	uint clean;				// generation this task last found nothing at, 0 if it has not this solve
+} schedule_task_t;
+
+typedef struct
+{
+	uint width;				// of the boards the estimates below are for
+	uint height;
+	uint task_count;		// the rules before parity, then each parity block size: 3 + (width - 1)*(height - 1)
+	uint task_capacity;
+	schedule_task_t *tasks;
+	uint generation;		// bumped whenever a task decides an edge
+	uint decided_count;		// edges decided by the running task, counted by decide_edge
+	uint64_t visit_count;	// cells, queued edges or parity blocks the running task looked at
+	uint parity_generation;	// generation the parity sums were built at
+} schedule_t;
+
+typedef struct
+{
+	uint capacity_width;	// buffers below are sized for boards up to this size
+	uint capacity_height;
 	uint *edge_h_old;
 	uint *edge_v_old;
 	uint *tmp1;			// temp storage: (width + 1)*(height + 1)
 	uint *tmp2;
+	uint *barrier_sum_h;	// summed-area table of barriers: (width + 1)*(height + 2)
+	uint *barrier_sum_v;	// (width + 2)*(height + 1)
+	uint *perimeter_sum_h;	// running { available, path } x parity counts along edge rows: 4*(width + 1)*(height + 1)
+	uint *perimeter_sum_v;	// along edge columns: 4*(width + 1)*(height + 1)
+	uint64_t *state_hash_h;	// summed-area xor of per edge state hashes, same layout as barrier_sum_h
+	uint64_t *state_hash_v;	// same layout as barrier_sum_v
+	uint64_t *parity_cache;	// hashes of blocks that deduced nothing, kept across solves: parity_cache_mask + 1
+	uint parity_cache_mask;
+	parity_counts_t *island_counts;	// per island of the current parity block: width*height + 1
+	bitboard_t *bitboard;	// optional bit-planes for word-parallel rules
+	worklist_t *worklist;	// optional state for event-driven solving
+	stats_t *stats;			// optional profiling counters
+	trace_t *trace;			// optional record of the edges each step changes
+	justify_t *justify;		// optional premises of each deduction, for incremental harden
+	schedule_t *schedule;	// optional rule order from measured cost and yield
+	struct parity_sweep_t *sweep;	// optional threads for the parity sweep of a single solve
+	struct round_pool_t *rounds;	// optional synchronous rounds, every rule against the same board
+	struct cell_kernels_t const *kernels;	// row kernels for the single cell and loop rules
 	bool verbose;
 } solver_t;
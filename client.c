@@ -0,0 +1,444 @@
+#define _POSIX_C_SOURCE 200809L
+#include "serve.h"
+#include "solver.h"
+#include "corpus.h"
+#include "io.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// client and load generator for the solver server: sends puzzles over some connections, each
+// keeping a number of requests in flight, then reports throughput and latency percentiles
+
+typedef struct
+{
+	char const *socket_path;
+	char const *path;		// puzzles to send, text or corpus
+	uint connection_count;
+	uint depth;				// requests in flight per connection
+	uint request_count;		// total, puzzles are sent round robin (0 for one of each)
+	bool print_results;
+} client_options_t;
+
+typedef struct
+{
+	uint8_t *data;			// whole request, the id is filled in per send
+	size_t size;
+} encoded_t;
+
+typedef struct
+{
+	uint64_t send_ns;
+	uint64_t latency_ns;
+	uint status;
+	uint step_count;
+	uint width;
+	uint height;
+	uint path_count;		// path edges in the response
+	bool is_done;
+} result_t;
+
+struct client_t;
+
+typedef struct
+{
+	struct client_t *client;
+	uint index;
+	int fd;
+	pthread_t sender;
+	pthread_t receiver;
+	pthread_mutex_t lock;	// guards in_flight_count
+	pthread_cond_t request_done;
+	uint in_flight_count;
+	bool is_failed;
+} connection_t;
+
+typedef struct client_t
+{
+	client_options_t options;
+	encoded_t *puzzles;
+	uint puzzle_count;
+	result_t *results;		// by request id
+} client_t;
+
+static
+uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static
+int compare_times(void const *a, void const *b)
+{
+	uint64_t const x = *(uint64_t const *)a;
+	uint64_t const y = *(uint64_t const *)b;
+	return (x > y) - (x < y);
+}
+
+static
+uint get_u32(uint8_t const *p)
+{
+	return (uint)p[0] | ((uint)p[1] << 8) | ((uint)p[2] << 16) | ((uint)p[3] << 24);
+}
+
+static
+void put_u32(uint8_t *p, uint value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+static
+bool read_all(int fd, uint8_t *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t const n = read(fd, data, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+static
+bool write_all(int fd, uint8_t const *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t const n = write(fd, data, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+static
+void add_puzzle(client_t *client, board_t const *board)
+{
+	client->puzzles = (encoded_t *)realloc(client->puzzles, (client->puzzle_count + 1)*sizeof(encoded_t));
+	encoded_t *const puzzle = client->puzzles + client->puzzle_count++;
+	size_t const bit_bytes = edge_bits_size(board->width, board->height);
+	puzzle->size = SERVE_HEADER_SIZE + SERVE_REQUEST_SIZE + bit_bytes;
+	puzzle->data = (uint8_t *)malloc(puzzle->size);
+	put_u32(puzzle->data, (uint)(SERVE_REQUEST_SIZE + bit_bytes));
+	put_u32(puzzle->data + 4, 0);
+	put_u32(puzzle->data + 8, board->width);
+	put_u32(puzzle->data + 12, board->height);
+	pack_edge_bits(puzzle->data + SERVE_HEADER_SIZE + SERVE_REQUEST_SIZE, board, EDGE_BOUNDARY);
+}
+
+// every puzzle in a text stream or corpus, encoded once up front
+static
+bool load_puzzles(client_t *client, char const *path)
+{
+	text_input_t input;
+	if (!open_text_input(&input, path)) {
+		return false;
+	}
+	board_t board;
+	memset(&board, 0, sizeof(board_t));
+	bool result = true;
+	if (input.is_mapped && is_corpus_data(input.data, input.size)) {
+		corpus_t corpus;
+		result = open_corpus(&corpus, path);
+		for (uint index = 0; result && index < corpus.puzzle_count; ++index) {
+			result = read_corpus_board(&corpus, index, &board, NULL, NULL);
+			if (result) {
+				add_puzzle(client, &board);
+			}
+		}
+		if (corpus.data) {
+			close_corpus(&corpus);
+		}
+	} else {
+		for (uint index = 0; result && skip_to_board(&input); ++index) {
+			result = scan_next_board(&board, &input);
+			if (result) {
+				add_puzzle(client, &board);
+			}
+		}
+	}
+	if (!result) {
+		fprintf(stderr, "%s: failed to read puzzle %u\n", path ? path : "stdin", client->puzzle_count);
+	}
+	free_board(&board);
+	close_text_input(&input);
+	return result;
+}
+
+// requests on connection c are c, c + connection_count, c + 2*connection_count, ...
+static
+void *sender_main(void *arg)
+{
+	connection_t *const connection = (connection_t *)arg;
+	client_t *const client = connection->client;
+	uint const depth = client->options.depth;
+	uint8_t *buffer = NULL;
+	size_t buffer_capacity = 0;
+	for (uint id = connection->index; id < client->options.request_count; id += client->options.connection_count) {
+		pthread_mutex_lock(&connection->lock);
+		while (connection->in_flight_count >= depth && !connection->is_failed) {
+			pthread_cond_wait(&connection->request_done, &connection->lock);
+		}
+		bool const is_failed = connection->is_failed;
+		++connection->in_flight_count;
+		pthread_mutex_unlock(&connection->lock);
+		if (is_failed) {
+			break;
+		}
+
+		encoded_t const *const puzzle = client->puzzles + id % client->puzzle_count;
+		if (puzzle->size > buffer_capacity) {
+			buffer_capacity = puzzle->size;
+			buffer = (uint8_t *)realloc(buffer, buffer_capacity);
+		}
+		memcpy(buffer, puzzle->data, puzzle->size);
+		put_u32(buffer + 4, id);
+		client->results[id].send_ns = now_ns();
+		if (!write_all(connection->fd, buffer, puzzle->size)) {
+			break;
+		}
+	}
+	shutdown(connection->fd, SHUT_WR);
+	free(buffer);
+	return NULL;
+}
+
+static
+uint count_bits(uint8_t const *bits, size_t size)
+{
+	uint count = 0;
+	for (size_t i = 0; i < size; ++i) {
+		count += (uint)__builtin_popcount(bits[i]);
+	}
+	return count;
+}
+
+static
+void *receiver_main(void *arg)
+{
+	connection_t *const connection = (connection_t *)arg;
+	client_t *const client = connection->client;
+	uint8_t *buffer = NULL;
+	size_t buffer_capacity = 0;
+	for (;;) {
+		uint8_t header[SERVE_HEADER_SIZE];
+		if (!read_all(connection->fd, header, sizeof(header))) {
+			break;
+		}
+		size_t const size = get_u32(header);
+		if (size < SERVE_RESPONSE_SIZE) {
+			fprintf(stderr, "malformed response!\n");
+			break;
+		}
+		if (size > buffer_capacity) {
+			buffer_capacity = size;
+			buffer = (uint8_t *)realloc(buffer, buffer_capacity);
+		}
+		if (!read_all(connection->fd, buffer, size)) {
+			break;
+		}
+		uint64_t const receive_ns = now_ns();
+		uint const id = get_u32(buffer);
+		if (id >= client->options.request_count) {
+			fprintf(stderr, "response for unknown request %u!\n", id);
+			break;
+		}
+		result_t *const result = client->results + id;
+		result->latency_ns = receive_ns - result->send_ns;
+		result->status = get_u32(buffer + 4);
+		result->step_count = get_u32(buffer + 8);
+		result->width = get_u32(buffer + 12);
+		result->height = get_u32(buffer + 16);
+		result->path_count = count_bits(buffer + SERVE_RESPONSE_SIZE, size - SERVE_RESPONSE_SIZE);
+		result->is_done = true;
+
+		pthread_mutex_lock(&connection->lock);
+		--connection->in_flight_count;
+		pthread_cond_signal(&connection->request_done);
+		pthread_mutex_unlock(&connection->lock);
+	}
+
+	// wake the sender if the server went away
+	pthread_mutex_lock(&connection->lock);
+	connection->is_failed = true;
+	pthread_cond_signal(&connection->request_done);
+	pthread_mutex_unlock(&connection->lock);
+	free(buffer);
+	return NULL;
+}
+
+static
+int connect_socket(char const *path)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "socket path \"%s\" is too long!\n", path);
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+	int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr const *)&address, sizeof(address)) != 0) {
+		fprintf(stderr, "failed to connect to \"%s\"!\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	return fd;
+}
+
+static
+char const *result_name(uint status)
+{
+	switch (status) {
+		case SOLVE_SOLVED:			return "solved";
+		case SOLVE_CONTRADICTION:	return "contradiction";
+		case SOLVE_GIVEN_UP:		return "given up";
+		default:					return "invalid";
+	}
+}
+
+static
+double percentile_us(uint64_t const *sorted, uint count, uint percent)
+{
+	if (count == 0) {
+		return 0.0;
+	}
+	return 1e-3*(double)sorted[min((uint)(((uint64_t)count*percent)/100), count - 1)];
+}
+
+int main(int argc, char *argv[])
+{
+	client_t client;
+	memset(&client, 0, sizeof(client_t));
+	client_options_t *const options = &client.options;
+	options->connection_count = 1;
+	options->depth = 1;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			options->socket_path = argv[++i];
+		} else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			options->path = argv[++i];
+		} else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+			options->connection_count = max((uint)strtoul(argv[++i], NULL, 10), 1);
+		} else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			options->depth = max((uint)strtoul(argv[++i], NULL, 10), 1);
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			options->request_count = (uint)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-p") == 0) {
+			options->print_results = true;
+		} else {
+			fprintf(stderr, "unknown option \"%s\"!\n", argv[i]);
+			return -1;
+		}
+	}
+	if (!options->socket_path) {
+		fprintf(stderr, "usage: alcazam-client -s socket [-f puzzles] [-c connections] [-d depth] [-n requests] [-p]\n");
+		return -1;
+	}
+	if (!load_puzzles(&client, options->path)) {
+		return -1;
+	}
+	if (client.puzzle_count == 0) {
+		fprintf(stderr, "no puzzles to send!\n");
+		return -1;
+	}
+	if (options->request_count == 0) {
+		options->request_count = client.puzzle_count;
+	}
+	client.results = (result_t *)calloc(options->request_count, sizeof(result_t));
+
+	connection_t *const connections = (connection_t *)calloc(options->connection_count, sizeof(connection_t));
+	uint connection_count = 0;
+	for (; connection_count < options->connection_count; ++connection_count) {
+		connection_t *const connection = connections + connection_count;
+		connection->client = &client;
+		connection->index = connection_count;
+		connection->fd = connect_socket(options->socket_path);
+		if (connection->fd < 0) {
+			break;
+		}
+		pthread_mutex_init(&connection->lock, NULL);
+		pthread_cond_init(&connection->request_done, NULL);
+	}
+
+	int result = 0;
+	uint64_t const start_ns = now_ns();
+	if (connection_count == options->connection_count) {
+		for (uint i = 0; i < connection_count; ++i) {
+			pthread_create(&connections[i].receiver, NULL, receiver_main, connections + i);
+			pthread_create(&connections[i].sender, NULL, sender_main, connections + i);
+		}
+		for (uint i = 0; i < connection_count; ++i) {
+			pthread_join(connections[i].sender, NULL);
+			pthread_join(connections[i].receiver, NULL);
+		}
+	} else {
+		result = -1;
+	}
+	double const seconds = 1e-9*(double)(now_ns() - start_ns);
+	for (uint i = 0; i < connection_count; ++i) {
+		pthread_cond_destroy(&connections[i].request_done);
+		pthread_mutex_destroy(&connections[i].lock);
+		close(connections[i].fd);
+	}
+	free(connections);
+
+	// results in request order, then the latency of every answered request
+	if (options->print_results && result == 0) {
+		printf("# request\tpuzzle\twidth\theight\tresult\tsteps\tpath\n");
+	}
+	uint64_t *const latencies = (uint64_t *)malloc(options->request_count*sizeof(uint64_t));
+	uint done_count = 0;
+	for (uint id = 0; id < options->request_count && result == 0; ++id) {
+		result_t const *const r = client.results + id;
+		if (!r->is_done) {
+			continue;
+		}
+		latencies[done_count++] = r->latency_ns;
+		if (options->print_results) {
+			printf("%u\t%u\t%u\t%u\t%s\t%u\t%u\n", id, id % client.puzzle_count, r->width, r->height, result_name(r->status), r->step_count, r->path_count);
+		}
+	}
+	fflush(stdout);
+	if (result == 0) {
+		qsort(latencies, done_count, sizeof(uint64_t), compare_times);
+		fprintf(stderr, "%u/%u requests on %u connections at depth %u in %.2fs, %.0f requests/sec\n",
+			done_count, options->request_count, connection_count, options->depth, seconds, (seconds > 0.0) ? done_count/seconds : 0.0);
+		fprintf(stderr, "latency p50 %.1fus p99 %.1fus max %.1fus\n",
+			percentile_us(latencies, done_count, 50), percentile_us(latencies, done_count, 99), percentile_us(latencies, done_count, 100));
+		if (done_count != options->request_count) {
+			result = -1;
+		}
+	}
+
+	free(latencies);
+	free(client.results);
+	for (uint i = 0; i < client.puzzle_count; ++i) {
+		free(client.puzzles[i].data);
+	}
+	free(client.puzzles);
+	return result;
+}
@@ -0,0 +1,284 @@
+#define _POSIX_C_SOURCE 200809L
+#include "corpus.h"
+#include "solver.h"
+#include "io.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static
+uint get_u32(uint8_t const *p)
+{
+	return (uint)p[0] | ((uint)p[1] << 8) | ((uint)p[2] << 16) | ((uint)p[3] << 24);
+}
+
+static
+uint64_t get_u64(uint8_t const *p)
+{
+	return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static
+void put_u32(uint8_t *p, uint value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+static
+void put_u64(uint8_t *p, uint64_t value)
+{
+	put_u32(p, (uint)value);
+	put_u32(p + 4, (uint)(value >> 32));
+}
+
+size_t edge_bits_size(uint width, uint height)
+{
+	size_t const edge_count = (size_t)width*(height + 1) + (size_t)(width + 1)*height;
+	return (edge_count + 7)/8;
+}
+
+bool is_corpus_data(void const *data, size_t size)
+{
+	return size >= 4 && memcmp(data, "AZB1", 4) == 0;
+}
+
+// maps the whole file, puzzles are decoded on demand through the index
+bool open_corpus(corpus_t *corpus, char const *path)
+{
+	memset(corpus, 0, sizeof(corpus_t));
+	int const fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "failed to open \"%s\" for reading!\n", path);
+		return false;
+	}
+	struct stat st;
+	void *data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size >= CORPUS_HEADER_SIZE) {
+		data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "\"%s\" is not a puzzle corpus!\n", path);
+		return false;
+	}
+	corpus->data = (uint8_t const *)data;
+	corpus->size = (size_t)st.st_size;
+
+	uint8_t const *const header = corpus->data;
+	corpus->puzzle_count = get_u32(header + 8);
+	corpus->flags = get_u32(header + 12);
+	corpus->index_offset = get_u64(header + 16);
+	if (!is_corpus_data(header, corpus->size) || get_u32(header + 4) != CORPUS_VERSION
+		|| corpus->index_offset > corpus->size || (corpus->size - corpus->index_offset)/8 < corpus->puzzle_count) {
+		fprintf(stderr, "\"%s\" is not a puzzle corpus!\n", path);
+		close_corpus(corpus);
+		return false;
+	}
+	return true;
+}
+
+void close_corpus(corpus_t *corpus)
+{
+	munmap((void *)corpus->data, corpus->size);
+	memset(corpus, 0, sizeof(corpus_t));
+}
+
+// unpack one bit per edge, edge storage is reused like a stream board
+void unpack_edge_bits(board_t *board, uint width, uint height, uint8_t const *bits, uint set_bits)
+{
+	uint const edge_count_h = width*(height + 1);
+	uint const edge_count_v = (width + 1)*height;
+	if (board->width != width || board->height != height || !board->edge_h) {
+		board->edge_h = (uint *)realloc(board->edge_h, edge_count_h*sizeof(uint));
+		board->edge_v = (uint *)realloc(board->edge_v, edge_count_v*sizeof(uint));
+		board->width = width;
+		board->height = height;
+	}
+	for (uint k = 0; k < edge_count_h; ++k) {
+		board->edge_h[k] = ((bits[k >> 3] >> (k & 7)) & 1) ? set_bits : 0;
+	}
+	for (uint i = 0; i < edge_count_v; ++i) {
+		uint const k = edge_count_h + i;
+		board->edge_v[i] = ((bits[k >> 3] >> (k & 7)) & 1) ? set_bits : 0;
+	}
+}
+
+// puzzle walls as scan_board would read them, plus the stored path in solution if there is one
+bool read_corpus_board(corpus_t const *corpus, uint index, board_t *board, board_t *solution, corpus_entry_t *entry)
+{
+	if (index >= corpus->puzzle_count) {
+		return false;
+	}
+	uint64_t const offset = get_u64(corpus->data + corpus->index_offset + 8*(uint64_t)index);
+	if (offset > corpus->size || corpus->size - offset < 12) {
+		return false;
+	}
+	uint8_t const *p = corpus->data + offset;
+	uint const width = get_u32(p);
+	uint const height = get_u32(p + 4);
+	uint const flags = get_u32(p + 8);
+	size_t const bit_bytes = edge_bits_size(width, height);
+	size_t const record_size = 12 + bit_bytes + ((flags & CORPUS_SOLUTION) ? bit_bytes : 0) + ((flags & CORPUS_STATS) ? 8 : 0);
+	if (width == 0 || height == 0 || !is_board_size_supported(width, height) || corpus->size - offset < record_size) {
+		return false;
+	}
+	p += 12;
+
+	unpack_edge_bits(board, width, height, p, EDGE_BOUNDARY | EDGE_BARRIER);
+	p += bit_bytes;
+	if (flags & CORPUS_SOLUTION) {
+		if (solution) {
+			unpack_edge_bits(solution, width, height, p, EDGE_PATH);
+			for (uint k = 0; k < width*(height + 1); ++k) {
+				solution->edge_h[k] |= board->edge_h[k];
+			}
+			for (uint k = 0; k < (width + 1)*height; ++k) {
+				solution->edge_v[k] |= board->edge_v[k];
+			}
+		}
+		p += bit_bytes;
+	}
+	if (entry) {
+		entry->flags = flags;
+		entry->status = SOLVE_GIVEN_UP;
+		entry->step_count = 0;
+		if (flags & CORPUS_STATS) {
+			entry->status = (solve_status_t)get_u32(p);
+			entry->step_count = get_u32(p + 4);
+		}
+	}
+	return true;
+}
+
+// the header is rewritten with the count and index offset once every puzzle is in
+bool open_corpus_writer(corpus_writer_t *writer, char const *path, uint flags)
+{
+	memset(writer, 0, sizeof(corpus_writer_t));
+	writer->fp = fopen(path, "wb");
+	if (!writer->fp) {
+		fprintf(stderr, "failed to open \"%s\" for writing!\n", path);
+		return false;
+	}
+	writer->flags = flags;
+	writer->offset = CORPUS_HEADER_SIZE;
+	uint8_t header[CORPUS_HEADER_SIZE];
+	memset(header, 0, sizeof(header));
+	fwrite(header, 1, sizeof(header), writer->fp);
+	return true;
+}
+
+void pack_edge_bits(uint8_t *bits, board_t const *board, uint mask)
+{
+	uint const edge_count_h = board->width*(board->height + 1);
+	uint const edge_count_v = (board->width + 1)*board->height;
+	memset(bits, 0, (edge_count_h + edge_count_v + 7)/8);
+	for (uint k = 0; k < edge_count_h; ++k) {
+		bits[k >> 3] |= (uint8_t)(((board->edge_h[k] & mask) != 0) << (k & 7));
+	}
+	for (uint i = 0; i < edge_count_v; ++i) {
+		uint const k = edge_count_h + i;
+		bits[k >> 3] |= (uint8_t)(((board->edge_v[i] & mask) != 0) << (k & 7));
+	}
+}
+
+// walls are the boundary edges of board, the solution is its path edges if it was solved
+void write_corpus_board(corpus_writer_t *writer, board_t const *board, solve_status_t status, uint step_count)
+{
+	uint flags = writer->flags;
+	if (status != SOLVE_SOLVED) {
+		flags &= ~CORPUS_SOLUTION;
+	}
+	size_t const bit_bytes = edge_bits_size(board->width, board->height);
+	size_t const record_size = 12 + bit_bytes + ((flags & CORPUS_SOLUTION) ? bit_bytes : 0) + ((flags & CORPUS_STATS) ? 8 : 0);
+	if (record_size > writer->buffer_capacity) {
+		writer->buffer_capacity = record_size;
+		writer->buffer = (uint8_t *)realloc(writer->buffer, record_size);
+	}
+
+	uint8_t *p = writer->buffer;
+	put_u32(p, board->width);
+	put_u32(p + 4, board->height);
+	put_u32(p + 8, flags);
+	p += 12;
+	pack_edge_bits(p, board, EDGE_BOUNDARY);
+	p += bit_bytes;
+	if (flags & CORPUS_SOLUTION) {
+		pack_edge_bits(p, board, EDGE_PATH);
+		p += bit_bytes;
+	}
+	if (flags & CORPUS_STATS) {
+		put_u32(p, status);
+		put_u32(p + 4, step_count);
+	}
+	fwrite(writer->buffer, 1, record_size, writer->fp);
+
+	if (writer->puzzle_count == writer->capacity) {
+		writer->capacity = writer->capacity ? 2*writer->capacity : 1024;
+		writer->offsets = (uint64_t *)realloc(writer->offsets, writer->capacity*sizeof(uint64_t));
+	}
+	writer->offsets[writer->puzzle_count++] = writer->offset;
+	writer->offset += record_size;
+}
+
+bool close_corpus_writer(corpus_writer_t *writer)
+{
+	uint8_t entry[8];
+	for (uint i = 0; i < writer->puzzle_count; ++i) {
+		put_u64(entry, writer->offsets[i]);
+		fwrite(entry, 1, sizeof(entry), writer->fp);
+	}
+
+	uint8_t header[CORPUS_HEADER_SIZE];
+	memcpy(header, "AZB1", 4);
+	put_u32(header + 4, CORPUS_VERSION);
+	put_u32(header + 8, writer->puzzle_count);
+	put_u32(header + 12, writer->flags);
+	put_u64(header + 16, writer->offset);
+	bool const result = fseek(writer->fp, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), writer->fp) == sizeof(header);
+	bool const is_closed = (fclose(writer->fp) == 0);
+	free(writer->offsets);
+	free(writer->buffer);
+	memset(writer, 0, sizeof(corpus_writer_t));
+	if (!result || !is_closed) {
+		fprintf(stderr, "failed to write puzzle corpus!\n");
+		return false;
+	}
+	return true;
+}
+
+// write a corpus back out as a stream of text puzzles that batch mode can read
+int run_unpack(char const *path)
+{
+	corpus_t corpus;
+	if (!open_corpus(&corpus, path)) {
+		return -1;
+	}
+	board_t board;
+	memset(&board, 0, sizeof(board_t));
+	int result = 0;
+	for (uint i = 0; i < corpus.puzzle_count; ++i) {
+		corpus_entry_t entry;
+		if (!read_corpus_board(&corpus, i, &board, NULL, &entry)) {
+			fprintf(stderr, "%s: failed to read puzzle %u\n", path, i);
+			result = -1;
+			break;
+		}
+		printf("# %s puzzle %u", path, i);
+		if (entry.flags & CORPUS_STATS) {
+			char const *const name = (entry.status == SOLVE_SOLVED) ? "solved" : (entry.status == SOLVE_CONTRADICTION) ? "contradiction" : "given up";
+			printf(" %s after %u steps", name, entry.step_count);
+		}
+		putchar('\n');
+		write_board(stdout, &board);
+		putchar('\n');
+	}
+	free_board(&board);
+	close_corpus(&corpus);
+	return result;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "board.h"
+#include <stdio.h>
+
+// indexed binary corpus (.azb), all integers are little-endian
+//   header: "AZB1" u32 version, u32 puzzle count, u32 flags, u64 index offset
+//   puzzle: u32 width, u32 height, u32 flags, one bit per edge for walls,
+//           then one bit per edge for the solution path if CORPUS_SOLUTION,
+//           then u32 result and u32 step count if CORPUS_STATS
+//   index:  u64 offset of each puzzle
+// edge bits number the horizontal edges first, then the vertical edges, lowest bit first
+
+#define CORPUS_VERSION		1
+#define CORPUS_HEADER_SIZE	24
+
+#define CORPUS_SOLUTION		0x01U	// puzzle stores the path found by solving it
+#define CORPUS_STATS		0x02U	// puzzle stores the solve result and step count
+
+typedef struct
+{
+	uint8_t const *data;	// whole file, mapped
+	size_t size;
+	uint puzzle_count;
+	uint flags;				// flags the corpus was written with, unsolved puzzles have no solution
+	uint64_t index_offset;
+} corpus_t;
+
+typedef struct
+{
+	uint flags;
+	solve_status_t status;	// valid with CORPUS_STATS
+	uint step_count;
+} corpus_entry_t;
+
+typedef struct
+{
+	FILE *fp;
+	uint flags;				// what to store for each puzzle
+	uint64_t offset;		// where the next puzzle goes
+	uint64_t *offsets;
+	uint puzzle_count;
+	uint capacity;
+	uint8_t *buffer;		// one puzzle record
+	size_t buffer_capacity;
+} corpus_writer_t;
+
+// one bit per edge in the order above, also used by the server protocol
+size_t edge_bits_size(uint width, uint height);
+void pack_edge_bits(uint8_t *bits, board_t const *board, uint mask);
+void unpack_edge_bits(board_t *board, uint width, uint height, uint8_t const *bits, uint set_bits);
+
+bool is_corpus_data(void const *data, size_t size);
+bool open_corpus(corpus_t *corpus, char const *path);
+void close_corpus(corpus_t *corpus);
+bool read_corpus_board(corpus_t const *corpus, uint index, board_t *board, board_t *solution, corpus_entry_t *entry);
+
+bool open_corpus_writer(corpus_writer_t *writer, char const *path, uint flags);
+void write_corpus_board(corpus_writer_t *writer, board_t const *board, solve_status_t status, uint step_count);
+bool close_corpus_writer(corpus_writer_t *writer);
+
+int run_unpack(char const *path);
@@ -0,0 +1,274 @@
+#define _POSIX_C_SOURCE 200809L
+#include "generate.h"
+#include "solver.h"
+#include "bitboard.h"
+#include "harden.h"
+#include "justify.h"
+#include "schedule.h"
+#include "io.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static
+void reverse_path(uint *path, uint *position, uint begin, uint end)
+{
+	while (begin + 1 < end) {
+		--end;
+		uint const tmp = path[begin];
+		path[begin] = path[end];
+		path[end] = tmp;
+		position[path[begin]] = begin;
+		position[path[end]] = end;
+		++begin;
+	}
+}
+
+static
+bool is_border_cell(uint width, uint height, uint i)
+{
+	uint const x = i % width;
+	uint const y = i / width;
+	return x == 0 || y == 0 || x + 1 == width || y + 1 == height;
+}
+
+// backbite moves from a boustrophedon path, continuing until both ends are on the border
+static
+void sample_path(uint width, uint height, mt_state_t *rng, uint *path, uint *position)
+{
+	uint const n = width*height;
+	for (uint y = 0; y < height; ++y)
+	for (uint x = 0; x < width; ++x) {
+		uint const i = y*width + ((y & 1) ? (width - 1 - x) : x);
+		path[y*width + x] = i;
+		position[i] = y*width + x;
+	}
+
+	uint const min_move_count = 20*n;
+	for (uint move_index = 0; move_index < min_move_count || !is_border_cell(width, height, path[0]) || !is_border_cell(width, height, path[n - 1]); ++move_index) {
+		uint const r = genrand_int32(rng);
+		bool const at_start = (r & 4) != 0;
+		uint const end = at_start ? path[0] : path[n - 1];
+		uint const x = end % width;
+		uint const y = end / width;
+		uint q;
+		switch (r & 3) {
+			case 0:		if (y == 0) continue; q = end - width; break;
+			case 1:		if (y + 1 == height) continue; q = end + width; break;
+			case 2:		if (x == 0) continue; q = end - 1; break;
+			default:	if (x + 1 == width) continue; q = end + 1; break;
+		}
+
+		// join the end to q and cut the path next to q, the cut becomes the new end
+		uint const i = position[q];
+		if (at_start) {
+			if (i != 1) {
+				reverse_path(path, position, 0, i);
+			}
+		} else {
+			if (i != n - 2) {
+				reverse_path(path, position, i + 1, n);
+			}
+		}
+	}
+}
+
+static
+void open_exit(board_t *board, uint i, mt_state_t *rng)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const x = i % width;
+	uint const y = i / width;
+	uint *exits[4];
+	uint exit_count = 0;
+	if (y == 0) {
+		exits[exit_count++] = board->edge_h + x;
+	}
+	if (y + 1 == height) {
+		exits[exit_count++] = board->edge_h + height*width + x;
+	}
+	if (x == 0) {
+		exits[exit_count++] = board->edge_v + y*(width + 1);
+	}
+	if (x + 1 == width) {
+		exits[exit_count++] = board->edge_v + y*(width + 1) + width;
+	}
+	*exits[genrand_int32(rng) % exit_count] = 0;
+}
+
+// wall off every edge the path does not use
+static
+void build_board(board_t *board, uint const *path, mt_state_t *rng)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const n = width*height;
+	for (uint i = 0; i < width*(height + 1); ++i) {
+		board->edge_h[i] = EDGE_BOUNDARY;
+	}
+	for (uint i = 0; i < (width + 1)*height; ++i) {
+		board->edge_v[i] = EDGE_BOUNDARY;
+	}
+	for (uint i = 0; i + 1 < n; ++i) {
+		uint const a = min(path[i], path[i + 1]);
+		uint const b = max(path[i], path[i + 1]);
+		if (b == a + 1) {
+			board->edge_v[(a / width)*(width + 1) + (a % width) + 1] = 0;
+		} else {
+			board->edge_h[b] = 0;
+		}
+	}
+	open_exit(board, path[0], rng);
+	open_exit(board, path[n - 1], rng);
+	reset_to_boundary(board);
+}
+
+// random puzzle with a wall on every edge its solution does not use, path needs 2*width*height entries
+void generate_walled_board(board_t *board, mt_state_t *rng, uint *path)
+{
+	uint *const position = path + board->width*board->height;
+	sample_path(board->width, board->height, rng, path, position);
+	build_board(board, path, rng);
+}
+
+static
+uint64_t hash_walls(board_t const *board)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (uint i = 0; i < board->width*(board->height + 1); ++i) {
+		hash = (hash ^ (board->edge_h[i] & EDGE_BOUNDARY))*1099511628211ULL;
+	}
+	for (uint i = 0; i < (board->width + 1)*board->height; ++i) {
+		hash = (hash ^ (board->edge_v[i] & EDGE_BOUNDARY))*1099511628211ULL;
+	}
+	return hash | 1;
+}
+
+// open addressing set of wall hashes, zero marks an empty slot
+static
+bool insert_hash(uint64_t *set, uint mask, uint64_t hash)
+{
+	for (uint i = (uint)hash & mask;; i = (i + 1) & mask) {
+		if (set[i] == hash) {
+			return false;
+		}
+		if (set[i] == 0) {
+			set[i] = hash;
+			return true;
+		}
+	}
+}
+
+static
+double elapsed_seconds(struct timespec const *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)(now.tv_sec - start->tv_sec) + 1e-9*(double)(now.tv_nsec - start->tv_nsec);
+}
+
+// write count distinct hardened puzzles as a stream that batch mode can read back
+int run_generate(generate_options_t const *options)
+{
+	uint const width = options->width;
+	uint const height = options->height;
+	if (width < 2 || height < 2) {
+		fprintf(stderr, "generated boards must be at least 2x2!\n");
+		return -1;
+	}
+	if (!is_board_size_supported(width, height)) {
+		fprintf(stderr, "generated boards must have fewer than a billion cells!\n");
+		return -1;
+	}
+
+	board_t board;
+	memset(&board, 0, sizeof(board_t));
+	board.width = width;
+	board.height = height;
+	board.edge_h = (uint *)malloc(width*(height + 1)*sizeof(uint));
+	board.edge_v = (uint *)malloc((width + 1)*height*sizeof(uint));
+	uint *const path = (uint *)malloc(2*width*height*sizeof(uint));
+
+	solver_t solver;
+	init_solver(&solver, &board);
+	bitboard_t bitboard;
+	if (options->use_bitboard) {
+		init_bitboard(&bitboard, &board);
+		solver.bitboard = &bitboard;
+	}
+	worklist_t worklist;
+	if (options->event_driven) {
+		init_worklist(&worklist, &board);
+		solver.worklist = &worklist;
+	}
+	justify_t justify;
+	if (options->incremental) {
+		init_justify(&justify, &board);
+		solver.justify = &justify;
+	}
+	schedule_t schedule;
+	if (options->adaptive) {
+		init_schedule(&schedule);
+		solver.schedule = &schedule;
+	}
+	solver.stats = options->stats;
+
+	uint set_size = 64;
+	while (set_size < 2*options->count) {
+		set_size *= 2;
+	}
+	uint64_t *const set = (uint64_t *)calloc(set_size, sizeof(uint64_t));
+
+	mt_state_t rng;
+	init_genrand(&rng, options->seed);
+
+	// small boards run out of distinct puzzles, so give up after plenty of repeats
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	uint puzzle_count = 0;
+	uint attempt_count = 0;
+	uint const max_attempt_count = 100*options->count + 100;
+	while (puzzle_count < options->count && attempt_count < max_attempt_count) {
+		++attempt_count;
+		generate_walled_board(&board, &rng, path);
+		harden_parallel(&solver, &board, &rng, options->thread_count);
+
+		// harden only keeps removals that still solve, check anyway before writing, without the deduction record
+		solve_status_t status;
+		solver.justify = NULL;
+		solve(&solver, &board, &status);
+		solver.justify = options->incremental ? &justify : NULL;
+		reset_to_boundary(&board);
+		if (status != SOLVE_SOLVED || !insert_hash(set, set_size - 1, hash_walls(&board))) {
+			continue;
+		}
+
+		printf("# generated %ux%u seed %lu puzzle %u\n", width, height, options->seed, puzzle_count);
+		write_board(stdout, &board);
+		putchar('\n');
+		++puzzle_count;
+	}
+	fflush(stdout);
+
+	double const seconds = elapsed_seconds(&start);
+	fprintf(stderr, "%u puzzles (%u attempts) in %.2fs, %.2f puzzles/sec\n", puzzle_count, attempt_count, seconds, (seconds > 0.0) ? puzzle_count/seconds : 0.0);
+
+	free(set);
+	if (solver.justify) {
+		free_justify(&justify);
+	}
+	if (solver.schedule) {
+		free_schedule(&schedule);
+	}
+	if (solver.worklist) {
+		free_worklist(&worklist);
+	}
+	if (solver.bitboard) {
+		free_bitboard(&bitboard);
+	}
+	free_solver(&solver);
+	free(path);
+	free_board(&board);
+	return (puzzle_count == options->count) ? 0 : -1;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "board.h"
+#include "mt19937.h"
+
+typedef struct
+{
+	uint width;
+	uint height;
+	uint count;				// number of distinct puzzles to write
+	unsigned long seed;
+	uint thread_count;		// used by harden
+	bool use_bitboard;
+	bool event_driven;
+	bool incremental;		// harden with justify_t, see justify.h
+	bool adaptive;			// order rules with schedule_t, see schedule.h
+	stats_t *stats;			// optional profiling counters
+} generate_options_t;
+
+void generate_walled_board(board_t *board, mt_state_t *rng, uint *path);
+int run_generate(generate_options_t const *options);
@@ -0,0 +1,352 @@
+#define _POSIX_C_SOURCE 200809L
+#include "harden.h"
+#include "solver.h"
+#include "bitboard.h"
+#include "stats.h"
+#include "justify.h"
+#include "schedule.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// scratch for another thread with the same optional modes as solver
+static
+void init_solver_like(solver_t *dst, bitboard_t *bitboard, worklist_t *worklist, justify_t *justify, schedule_t *schedule, stats_t *stats, solver_t const *solver, board_t const *board)
+{
+	init_solver(dst, board);
+	dst->kernels = solver->kernels;
+	if (solver->stats) {
+		init_stats(stats);
+		dst->stats = stats;
+	}
+	if (solver->bitboard) {
+		init_bitboard(bitboard, board);
+		dst->bitboard = bitboard;
+	}
+	if (solver->worklist) {
+		init_worklist(worklist, board);
+		dst->worklist = worklist;
+	}
+	if (solver->justify) {
+		init_justify(justify, board);
+		dst->justify = justify;
+	}
+	if (solver->schedule) {
+		init_schedule(schedule);
+		dst->schedule = schedule;
+	}
+}
+
+// counters are added to the parent solver's, call once this thread has finished
+static
+void free_solver_like(solver_t *solver, solver_t const *parent)
+{
+	if (solver->stats) {
+		merge_stats(parent->stats, solver->stats);
+		free_stats(solver->stats);
+	}
+	if (solver->bitboard) {
+		free_bitboard(solver->bitboard);
+	}
+	if (solver->worklist) {
+		free_worklist(solver->worklist);
+	}
+	if (solver->justify) {
+		free_justify(solver->justify);
+	}
+	if (solver->schedule) {
+		free_schedule(solver->schedule);
+	}
+	free_solver(solver);
+}
+
+struct speculate_t;
+
+typedef struct
+{
+	struct speculate_t *speculate;
+	uint index;
+	pthread_t thread;
+	solver_t solver;		// scratch space private to this thread
+	bitboard_t bitboard;
+	worklist_t worklist;
+	justify_t justify;
+	schedule_t schedule;
+	stats_t stats;
+	solver_t const *active;	// the solver used, thread 0 borrows the caller's
+	board_t test;			// board with this thread's trial applied
+	bool is_solved;
+} speculator_t;
+
+typedef struct speculate_t
+{
+	board_t *board;			// committed board, only changes between rounds
+	uint const *trials;
+	uint thread_count;
+	speculator_t *speculators;
+	pthread_mutex_t lock;
+	pthread_cond_t round_start;
+	pthread_cond_t round_done;
+	uint round;				// incremented to start each round
+	uint first_trial;		// trial index run by thread 0 this round
+	uint trial_count;		// trials run this round, at most thread_count
+	uint pending_count;
+	bool is_finished;
+} speculate_t;
+
+static
+void run_speculation(speculator_t *speculator)
+{
+	speculate_t const *const speculate = speculator->speculate;
+	speculator->is_solved = false;
+	if (speculator->index < speculate->trial_count) {
+		uint const trial = speculate->trials[speculate->first_trial + speculator->index];
+		speculator->is_solved = harden_trial(speculator->active, speculate->board, &speculator->test, trial);
+	}
+}
+
+static
+void *speculator_main(void *arg)
+{
+	speculator_t *const speculator = (speculator_t *)arg;
+	speculate_t *const speculate = speculator->speculate;
+	uint round = 0;
+	for (;;) {
+		pthread_mutex_lock(&speculate->lock);
+		while (speculate->round == round && !speculate->is_finished) {
+			pthread_cond_wait(&speculate->round_start, &speculate->lock);
+		}
+		bool const is_finished = speculate->is_finished;
+		round = speculate->round;
+		pthread_mutex_unlock(&speculate->lock);
+		if (is_finished) {
+			break;
+		}
+
+		run_speculation(speculator);
+
+		pthread_mutex_lock(&speculate->lock);
+		if (--speculate->pending_count == 0) {
+			pthread_cond_signal(&speculate->round_done);
+		}
+		pthread_mutex_unlock(&speculate->lock);
+	}
+	return NULL;
+}
+
+// run the next thread_count trials against the committed board, all threads take part
+static
+void run_round(speculate_t *speculate, uint first_trial, uint trial_count)
+{
+	pthread_mutex_lock(&speculate->lock);
+	speculate->first_trial = first_trial;
+	speculate->trial_count = trial_count;
+	speculate->pending_count = speculate->thread_count - 1;
+	++speculate->round;
+	pthread_cond_broadcast(&speculate->round_start);
+	pthread_mutex_unlock(&speculate->lock);
+
+	run_speculation(speculate->speculators);
+
+	pthread_mutex_lock(&speculate->lock);
+	while (speculate->pending_count != 0) {
+		pthread_cond_wait(&speculate->round_done, &speculate->lock);
+	}
+	pthread_mutex_unlock(&speculate->lock);
+}
+
+// same removals as harden for the same rng state, with the next few trials solved concurrently
+uint harden_parallel(solver_t const *solver, board_t *board, mt_state_t *rng, uint thread_count)
+{
+	// incremental trials start from the board the last one kept, so they run one at a time
+	if (thread_count <= 1 || solver->justify) {
+		return harden(solver, board, rng);
+	}
+
+	uint *const trials = (uint *)malloc(2*(board->width + 1)*(board->height + 1)*sizeof(uint));
+	uint const trial_count = harden_trials(board, rng, trials);
+
+	speculate_t speculate;
+	memset(&speculate, 0, sizeof(speculate_t));
+	speculate.board = board;
+	speculate.trials = trials;
+	speculate.thread_count = thread_count;
+	speculate.speculators = (speculator_t *)calloc(thread_count, sizeof(speculator_t));
+	pthread_mutex_init(&speculate.lock, NULL);
+	pthread_cond_init(&speculate.round_start, NULL);
+	pthread_cond_init(&speculate.round_done, NULL);
+	for (uint i = 0; i < thread_count; ++i) {
+		speculator_t *const speculator = speculate.speculators + i;
+		speculator->speculate = &speculate;
+		speculator->index = i;
+		speculator->active = solver;
+		if (i > 0) {
+			init_solver_like(&speculator->solver, &speculator->bitboard, &speculator->worklist, &speculator->justify, &speculator->schedule, &speculator->stats, solver, board);
+			speculator->active = &speculator->solver;
+			pthread_create(&speculator->thread, NULL, speculator_main, speculator);
+		}
+		copy_board(&speculator->test, board);
+	}
+
+	// commit the first success in trial order, later results were solved against the old board so rerun them
+	uint success_count = 0;
+	for (uint trial_index = 0; trial_index < trial_count;) {
+		uint const round_count = min(thread_count, trial_count - trial_index);
+		run_round(&speculate, trial_index, round_count);
+
+		uint i = 0;
+		while (i < round_count && !speculate.speculators[i].is_solved) {
+			++i;
+		}
+		if (i < round_count) {
+			swap_board(board, &speculate.speculators[i].test);
+			++success_count;
+			trial_index += i + 1;
+		} else {
+			trial_index += round_count;
+		}
+	}
+
+	pthread_mutex_lock(&speculate.lock);
+	speculate.is_finished = true;
+	pthread_cond_broadcast(&speculate.round_start);
+	pthread_mutex_unlock(&speculate.lock);
+	for (uint i = 0; i < thread_count; ++i) {
+		speculator_t *const speculator = speculate.speculators + i;
+		if (i > 0) {
+			pthread_join(speculator->thread, NULL);
+			free_solver_like(&speculator->solver, solver);
+		}
+		free_board(&speculator->test);
+	}
+	pthread_cond_destroy(&speculate.round_done);
+	pthread_cond_destroy(&speculate.round_start);
+	pthread_mutex_destroy(&speculate.lock);
+	free(speculate.speculators);
+	free(trials);
+	reset_to_boundary(board);
+	return success_count;
+}
+
+uint count_walls(board_t const *board)
+{
+	uint wall_count = 0;
+	for (uint i = 0; i < board->width*(board->height + 1); ++i) {
+		wall_count += ((board->edge_h[i] & EDGE_BOUNDARY) != 0);
+	}
+	for (uint i = 0; i < (board->width + 1)*board->height; ++i) {
+		wall_count += ((board->edge_v[i] & EDGE_BOUNDARY) != 0);
+	}
+	return wall_count;
+}
+
+struct restarts_t;
+
+typedef struct
+{
+	struct restarts_t *restarts;
+	pthread_t thread;
+	solver_t solver;
+	bitboard_t bitboard;
+	worklist_t worklist;
+	justify_t justify;
+	schedule_t schedule;
+	stats_t stats;
+	solver_t const *active;
+	board_t test;
+	board_t best;			// fewest walls of the restarts run on this thread
+	uint best_restart;		// NOT_ON_PATH until a restart has finished
+} restarter_t;
+
+typedef struct restarts_t
+{
+	board_t const *board;	// puzzle before hardening
+	unsigned long seed;
+	uint restart_count;
+	uint *wall_counts;
+	pthread_mutex_t lock;
+	uint next_restart;
+} restarts_t;
+
+static
+void *restarter_main(void *arg)
+{
+	restarter_t *const restarter = (restarter_t *)arg;
+	restarts_t *const restarts = restarter->restarts;
+	for (;;) {
+		pthread_mutex_lock(&restarts->lock);
+		uint const restart = restarts->next_restart;
+		if (restart < restarts->restart_count) {
+			++restarts->next_restart;
+		}
+		pthread_mutex_unlock(&restarts->lock);
+		if (restart >= restarts->restart_count) {
+			break;
+		}
+
+		// each restart has its own stream so results do not depend on the thread count
+		mt_state_t rng;
+		init_genrand(&rng, restarts->seed + restart);
+		copy_board_edges(&restarter->test, restarts->board);
+		harden(restarter->active, &restarter->test, &rng);
+		uint const wall_count = count_walls(&restarter->test);
+		restarts->wall_counts[restart] = wall_count;
+
+		// ties go to the lowest restart index
+		if (restarter->best_restart == NOT_ON_PATH || wall_count < restarts->wall_counts[restarter->best_restart] || (wall_count == restarts->wall_counts[restarter->best_restart] && restart < restarter->best_restart)) {
+			swap_board(&restarter->best, &restarter->test);
+			restarter->best_restart = restart;
+		}
+	}
+	return NULL;
+}
+
+// run harden from restart_count seeds in parallel and keep the result with fewest walls
+uint harden_restarts(solver_t const *solver, board_t *board, unsigned long seed, uint restart_count, uint thread_count, uint *wall_counts)
+{
+	restarts_t restarts;
+	memset(&restarts, 0, sizeof(restarts_t));
+	restarts.board = board;
+	restarts.seed = seed;
+	restarts.restart_count = restart_count;
+	restarts.wall_counts = wall_counts;
+	pthread_mutex_init(&restarts.lock, NULL);
+
+	thread_count = max(min(thread_count, restart_count), 1);
+	restarter_t *const restarters = (restarter_t *)calloc(thread_count, sizeof(restarter_t));
+	for (uint i = 0; i < thread_count; ++i) {
+		restarter_t *const restarter = restarters + i;
+		restarter->restarts = &restarts;
+		restarter->active = solver;
+		restarter->best_restart = NOT_ON_PATH;
+		copy_board(&restarter->test, board);
+		copy_board(&restarter->best, board);
+		if (i > 0) {
+			init_solver_like(&restarter->solver, &restarter->bitboard, &restarter->worklist, &restarter->justify, &restarter->schedule, &restarter->stats, solver, board);
+			restarter->active = &restarter->solver;
+			pthread_create(&restarter->thread, NULL, restarter_main, restarter);
+		}
+	}
+	restarter_main(restarters);
+
+	for (uint i = 1; i < thread_count; ++i) {
+		pthread_join(restarters[i].thread, NULL);
+		free_solver_like(&restarters[i].solver, solver);
+	}
+
+	// the input board is shared until every thread has finished
+	uint best_restart = NOT_ON_PATH;
+	for (uint i = 0; i < thread_count; ++i) {
+		restarter_t *const restarter = restarters + i;
+		uint const r = restarter->best_restart;
+		if (r != NOT_ON_PATH && (best_restart == NOT_ON_PATH || wall_counts[r] < wall_counts[best_restart] || (wall_counts[r] == wall_counts[best_restart] && r < best_restart))) {
+			best_restart = r;
+			copy_board_edges(board, &restarter->best);
+		}
+		free_board(&restarter->test);
+		free_board(&restarter->best);
+	}
+	free(restarters);
+	pthread_mutex_destroy(&restarts.lock);
+	return best_restart;
+}
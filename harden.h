@@ -0,0 +1,8 @@
+#pragma once
+
+#include "board.h"
+#include "mt19937.h"
+
+uint harden_parallel(solver_t const *solver, board_t *board, mt_state_t *rng, uint thread_count);
+uint count_walls(board_t const *board);
+uint harden_restarts(solver_t const *solver, board_t *board, unsigned long seed, uint restart_count, uint thread_count, uint *wall_counts);
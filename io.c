@@ -1,6 +1,11 @@
+#define _POSIX_C_SOURCE 200809L
 #include "io.h"
 #include <stdlib.h>
 #include <memory.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 typedef struct
 {
@@ -32,44 +37,149 @@ typedef enum
 	COLOR_OFF
 } color_t;
 
-bool scan_board(board_t *board, FILE *fp)
+static inline
+size_t min_size(size_t a, size_t b)
 {
-	char buf[1024];
+	return (a < b) ? a : b;
+}
 
-	uint width = 0;
-	uint *edge_h = NULL;
-	uint *edge_v = NULL;
+// regular files are mapped whole, anything else is read in large chunks into a window that grows to fit a board
+bool open_text_input(text_input_t *input, char const *path)
+{
+	memset(input, 0, sizeof(text_input_t));
+	if (!path) {
+		input->fp = stdin;
+	} else {
+		int const fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			fprintf(stderr, "failed to open \"%s\" for reading!\n", path);
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+			void *const data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+				input->data = (char *)data;
+				input->size = (size_t)st.st_size;
+				input->is_mapped = true;
+				close(fd);
+				return true;
+			}
+		}
+		input->fp = fdopen(fd, "r");
+		input->is_owner = true;
+	}
+	input->capacity = TEXT_INPUT_CHUNK;
+	input->data = (char *)malloc(input->capacity);
+	return true;
+}
 
-	// read lines, expand the board as we go
-	uint line_index = 0;
-	uint first_edge = 0;
+void close_text_input(text_input_t *input)
+{
+	if (input->is_mapped) {
+		munmap(input->data, input->size);
+	} else {
+		free(input->data);
+	}
+	if (input->is_owner) {
+		fclose(input->fp);
+	}
+	memset(input, 0, sizeof(text_input_t));
+}
+
+// move unparsed bytes to the front and read another chunk, false at the end of input
+static
+bool refill(text_input_t *input)
+{
+	if (!input->fp || input->is_eof) {
+		return false;
+	}
+	memmove(input->data, input->data + input->pos, input->size - input->pos);
+	input->size -= input->pos;
+	input->pos = 0;
+	if (input->capacity - input->size < TEXT_INPUT_CHUNK/2) {
+		input->capacity *= 2;
+		input->data = (char *)realloc(input->data, input->capacity);
+	}
+	size_t const count = fread(input->data + input->size, 1, input->capacity - input->size, input->fp);
+	input->size += count;
+	input->is_eof = (count == 0);
+	return count > 0;
+}
+
+// make sure the whole line at offset bytes past the parse position is buffered, offsets survive a refill
+static
+bool peek_line(text_input_t *input, size_t offset, size_t *length)
+{
 	for (;;) {
-		memset(buf, 0, first_edge + width*4 + 1);
-		if (!fgets(buf, sizeof(buf), fp)) {
-			break;
+		size_t const available = input->size - input->pos;
+		if (offset < available) {
+			char const *const line = input->data + input->pos + offset;
+			char const *const end = (char const *)memchr(line, '\n', available - offset);
+			if (end) {
+				*length = (size_t)(end - line);
+				return true;
+			}
+		}
+		if (!refill(input)) {
+			if (offset < input->size - input->pos) {
+				*length = input->size - input->pos - offset;
+				return true;
+			}
+			return false;
 		}
+	}
+}
 
-		// ignore blank or comment lines
-		if (*buf == '#' || *buf == '\r' || *buf == '\n') {
+static inline
+bool is_skipped_line(char const *line, size_t length)
+{
+	return length == 0 || *line == '#' || *line == '\r';
+}
+
+static inline
+char char_at(char const *line, size_t length, size_t i)
+{
+	return (i < length) ? line[i] : '\0';
+}
+
+// line starting at p within [p, end), returns the start of the next line
+static inline
+char const *split_line(char const *p, char const *end, size_t *length)
+{
+	char const *const line_end = (char const *)memchr(p, '\n', (size_t)(end - p));
+	*length = line_end ? (size_t)(line_end - p) : (size_t)(end - p);
+	return line_end ? (line_end + 1) : end;
+}
+
+// in a stream, boards end at the first blank or comment line and reuse the edge storage of the previous board
+static
+bool scan_board_lines(board_t *board, text_input_t *input, bool is_stream)
+{
+	// find the extent of the board so the edges are sized once, the lines stay buffered for decoding
+	size_t first_edge = 0;
+	uint width = 0;
+	uint line_count = 0;
+	size_t offset = 0;
+	for (size_t length; peek_line(input, offset, &length); offset += length + 1) {
+		char const *const line = input->data + input->pos + offset;
+		if (is_skipped_line(line, length)) {
+			if (is_stream && (line_count & 1) != 0) {
+				offset += length + 1;
+				break;
+			}
 			continue;
 		}
 
 		// first line specifies character offset and board width
-		if (width == 0) {
-			char *p = buf;
-			for (;; ++first_edge) {
-				char const c = p[first_edge];
-				if (c == '\0' || c == '+') {
-					break;
-				}
+		if (line_count == 0) {
+			while (first_edge < length && line[first_edge] != '+') {
+				++first_edge;
 			}
-			uint last_edge = first_edge;
-			for (uint i = first_edge + 1;; ++i) {
-				char const c = p[i];
-				if (c == '\0') {
-					break;
-				}
-				if (c == '+') {
+			size_t last_edge = first_edge;
+			for (size_t i = first_edge + 1; i < length; ++i) {
+				if (line[i] == '+') {
 					last_edge = i;
 				}
 			}
@@ -78,41 +188,109 @@ bool scan_board(board_t *board, FILE *fp)
 				fprintf(stderr, "invalid board width");
 				return false;
 			}
-			width = last_edge/4;
-			edge_h = malloc(width*sizeof(uint));
+			width = (uint)(last_edge/4);
 		}
+		++line_count;
+	}
+	char const *p = input->data + input->pos;
+	char const *const end = input->data + min_size(input->pos + offset, input->size);
+	input->pos = (size_t)(end - input->data);
+	if ((line_count & 1) == 0 || line_count == 1) {
+		fprintf(stderr, "invalid board height");
+		return false;
+	}
+
+	uint const height = (line_count - 1)/2;
+	if (!is_board_size_supported(width, height)) {
+		fprintf(stderr, "board is too large!\n");
+		return false;
+	}
+	uint *const edge_h = (uint *)realloc(is_stream ? board->edge_h : NULL, width*(height + 1)*sizeof(uint));
+	uint *const edge_v = (uint *)realloc(is_stream ? board->edge_v : NULL, (width + 1)*height*sizeof(uint));
 
-		// read vertical or horizontal marks
+	// decode each line where it lies in the input
+	for (uint line_index = 0; line_index < line_count;) {
+		size_t length;
+		char const *const line = p;
+		p = split_line(p, end, &length);
+		if (is_skipped_line(line, length)) {
+			continue;
+		}
 		if (line_index & 1) {
-			uint const height = (line_index + 1)/2;
-			edge_h = (uint *)realloc(edge_h, width*(height + 1)*sizeof(uint));
-			edge_v = (uint *)realloc(edge_v, (width + 1)*height*sizeof(uint));
-			uint *const v = edge_v + (width + 1)*(height - 1);
+			uint *const v = edge_v + (width + 1)*(line_index/2);
 			for (uint x = 0; x <= width; ++x) {
-				v[x] = (buf[first_edge + 4*x] == '|') ? (EDGE_BOUNDARY | EDGE_BARRIER) : 0;
+				v[x] = (char_at(line, length, first_edge + 4*x) == '|') ? (EDGE_BOUNDARY | EDGE_BARRIER) : 0;
 			}
 		} else {
-			uint const height = line_index/2;
-			uint *const h = edge_h + width*height;
+			uint *const h = edge_h + width*(line_index/2);
 			for (uint x = 0; x < width; ++x) {
-				h[x] = (buf[first_edge + 4*x + 2] == '-') ? (EDGE_BOUNDARY | EDGE_BARRIER) : 0;
+				h[x] = (char_at(line, length, first_edge + 4*x + 2) == '-') ? (EDGE_BOUNDARY | EDGE_BARRIER) : 0;
 			}
 		}
 		++line_index;
 	}
 
-	if ((line_index & 1) == 0 || line_index == 1) {
-		fprintf(stderr, "invalid board height");
-		return false;
-	}
-
 	board->width = width;
-	board->height = (line_index - 1)/2;
+	board->height = height;
 	board->edge_h = edge_h;
 	board->edge_v = edge_v;
 	return true;
 }
 
+bool scan_board(board_t *board, text_input_t *input)
+{
+	return scan_board_lines(board, input, false);
+}
+
+bool scan_next_board(board_t *board, text_input_t *input)
+{
+	return scan_board_lines(board, input, true);
+}
+
+bool skip_to_board(text_input_t *input)
+{
+	for (size_t length; peek_line(input, 0, &length);) {
+		if (!is_skipped_line(input->data + input->pos, length)) {
+			return true;
+		}
+		input->pos = min_size(input->pos + length + 1, input->size);
+	}
+	return false;
+}
+
+// next line without its newline, only valid until the next read from the input
+bool read_line(text_input_t *input, char const **line, size_t *length)
+{
+	if (!peek_line(input, 0, length)) {
+		return false;
+	}
+	*line = input->data + input->pos;
+	input->pos = min_size(input->pos + *length + 1, input->size);
+	return true;
+}
+
+// plain puzzle format as read by scan_board, boundary edges only
+void write_board(FILE *fp, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	for (uint y = 0; y <= height; ++y) {
+		for (uint x = 0; x < width; ++x) {
+			fputs((edge_h[y*width + x] & EDGE_BOUNDARY) ? "+---" : "+   ", fp);
+		}
+		fputs("+\n", fp);
+		if (y == height) {
+			break;
+		}
+		for (uint x = 0; x <= width; ++x) {
+			fputs((edge_v[y*(width + 1) + x] & EDGE_BOUNDARY) ? "|" : " ", fp);
+			fputs((x < width) ? "   " : "\n", fp);
+		}
+	}
+}
+
 void print_board(solver_t const *solver, board_t const *board, uint bits)
 {
 	uint const width = board->width;
@@ -129,16 +307,16 @@ void print_board(solver_t const *solver, board_t const *board, uint bits)
 	bool const show_highlight = (bits & EDGE_HIGHLIGHT);
 	bool const show_new = (bits & EDGE_NEW);
 
-	uint const raster_width = 4*width + 1;
-	uint const raster_height = 2*height + 1;
-	uint const raster_count = raster_width*raster_height;
+	size_t const raster_width = 4*(size_t)width + 1;
+	size_t const raster_height = 2*(size_t)height + 1;
+	size_t const raster_count = raster_width*raster_height;
 	raster_t *const raster = (raster_t *)malloc(raster_count*sizeof(raster_t));
 	memset(raster, 0, raster_count*sizeof(raster_t));
 
 	// write tick marks
 	for (uint y = 0; y <= height; ++y)
 	for (uint x = 0; x <= width; ++x) {
-		uint const ir = 2*y*raster_width + 4*x;
+		size_t const ir = 2*y*raster_width + 4*x;
 		raster[ir].is_corner = 1;
 	}
 
@@ -146,7 +324,7 @@ void print_board(solver_t const *solver, board_t const *board, uint bits)
 	for (uint y = 0; y <= height; ++y)
 	for (uint x = 0; x < width; ++x) {
 		uint const ih = y*width + x;
-		uint const ir = 2*y*raster_width + 4*x;
+		size_t const ir = 2*y*raster_width + 4*x;
 		uint const is_new = (show_new && (edge_h_old[ih] & (EDGE_BARRIER | EDGE_PATH)) == 0) ? 1 : 0;
 		if (edge_h[ih] & boundary_bit) {
 			raster[ir + 1].is_boundary_h = 1;
@@ -176,7 +354,7 @@ void print_board(solver_t const *solver, board_t const *board, uint bits)
 	for (uint y = 0; y < height; ++y)
 	for (uint x = 0; x <= width; ++x) {
 		uint const iv = y*(width + 1) + x;
-		uint const ir = 2*y*raster_width + 4*x;
+		size_t const ir = 2*y*raster_width + 4*x;
 		uint const is_new = (show_new && (edge_v_old[iv] & (EDGE_BARRIER | EDGE_PATH)) == 0) ? 1 : 0;
 		if (edge_v[iv] & boundary_bit) {
 			raster[ir + raster_width].is_boundary_v = 1;
@@ -209,7 +387,7 @@ void print_board(solver_t const *solver, board_t const *board, uint bits)
 		for (uint y = 0; y < height; ++y)
 		for (uint x = 0; x < width; ++x) {
 			if (highlights[y*width + x]) {
-				uint const ir = 2*y*raster_width + 4*x;
+				size_t const ir = 2*y*raster_width + 4*x;
 				for (uint oy = 0; oy <= 2; ++oy)
 				for (uint ox = 0; ox <= 4; ++ox) {
 					raster[ir + oy*raster_width + ox].is_lit = 1;
@@ -3,5 +3,27 @@
 #include "board.h"
 #include <stdio.h>
 
-bool scan_board(board_t *board, FILE *fp);
+#define TEXT_INPUT_CHUNK	(1U << 20)
+
+// puzzle text either mapped whole or read through a buffer, lines are parsed where they lie
+typedef struct
+{
+	FILE *fp;			// source of buffered reads, NULL when mapped
+	char *data;			// mapped file, or buffered bytes
+	size_t size;		// valid bytes in data
+	size_t pos;			// next byte to parse
+	size_t capacity;	// buffer size, grows when a board does not fit
+	bool is_mapped;
+	bool is_owner;		// fp was opened here
+	bool is_eof;
+} text_input_t;
+
+bool open_text_input(text_input_t *input, char const *path);
+void close_text_input(text_input_t *input);
+bool read_line(text_input_t *input, char const **line, size_t *length);
+
+bool scan_board(board_t *board, text_input_t *input);
+bool scan_next_board(board_t *board, text_input_t *input);
+bool skip_to_board(text_input_t *input);
+void write_board(FILE *fp, board_t const *board);
 void print_board(solver_t const *solver, board_t const *board, uint bits);
@@ -0,0 +1,232 @@
+#include "justify.h"
+#include <stdlib.h>
+#include <memory.h>
+
+#define JUSTIFY_MIN_EVENTS		256
+#define JUSTIFY_MIN_PREMISES	4096
+
+static
+void init_justification(justification_t *justification, uint edge_count)
+{
+	memset(justification, 0, sizeof(justification_t));
+	justification->cause = (uint *)malloc(edge_count*sizeof(uint));
+	justification->event_capacity = JUSTIFY_MIN_EVENTS;
+	justification->premise_start = (uint *)malloc((justification->event_capacity + 1)*sizeof(uint));
+	justification->premise_capacity = JUSTIFY_MIN_PREMISES;
+	justification->premises = (uint *)malloc(justification->premise_capacity*sizeof(uint));
+	justification->premise_start[0] = 0;
+}
+
+static
+void free_justification(justification_t *justification)
+{
+	free(justification->cause);
+	free(justification->premise_start);
+	free(justification->premises);
+	memset(justification, 0, sizeof(justification_t));
+}
+
+static
+void reserve_justification(justification_t *justification, uint event_count, uint premise_count)
+{
+	if (event_count > justification->event_capacity) {
+		while (justification->event_capacity < event_count) {
+			justification->event_capacity *= 2;
+		}
+		justification->premise_start = (uint *)realloc(justification->premise_start, (justification->event_capacity + 1)*sizeof(uint));
+	}
+	if (premise_count > justification->premise_capacity) {
+		while (justification->premise_capacity < premise_count) {
+			justification->premise_capacity *= 2;
+		}
+		justification->premises = (uint *)realloc(justification->premises, justification->premise_capacity*sizeof(uint));
+	}
+}
+
+void init_justify(justify_t *justify, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const edge_count = width*(height + 1) + (width + 1)*height;
+
+	memset(justify, 0, sizeof(justify_t));
+	init_justification(&justify->record, edge_count);
+	init_justification(&justify->base, edge_count);
+	justify->remap_capacity = JUSTIFY_MIN_EVENTS;
+	justify->remap = (uint *)malloc(justify->remap_capacity*sizeof(uint));
+	justify->segment_start = (uint *)malloc((width*height + 2)*sizeof(uint));
+	justify->segment_edges = (uint *)malloc(2*(width + 1)*(height + 1)*sizeof(uint));
+}
+
+void free_justify(justify_t *justify)
+{
+	free_justification(&justify->record);
+	free_justification(&justify->base);
+	free(justify->remap);
+	free(justify->segment_start);
+	free(justify->segment_edges);
+	memset(justify, 0, sizeof(justify_t));
+}
+
+// start recording a solve of board from its walls
+void justify_begin(justify_t *justify, board_t const *board)
+{
+	justification_t *const record = &justify->record;
+	justify->edge_count_h = board->width*(board->height + 1);
+	justify->edge_count = justify->edge_count_h + (board->width + 1)*board->height;
+	for (uint k = 0; k < justify->edge_count; ++k) {
+		record->cause[k] = NO_CAUSE;
+	}
+	record->event_count = 0;
+	record->premise_count = 0;
+	record->premise_start[0] = 0;
+}
+
+void justify_premise(justify_t *justify, uint k)
+{
+	justification_t *const record = &justify->record;
+	reserve_justification(record, record->event_count, record->premise_count + 1);
+	record->premises[record->premise_count++] = k;
+}
+
+void justify_decided(justify_t *justify, uint k)
+{
+	justify->record.cause[k] = justify->record.event_count;
+}
+
+void justify_end(justify_t *justify)
+{
+	justification_t *const record = &justify->record;
+	reserve_justification(record, record->event_count + 1, record->premise_count);
+	record->premise_start[++record->event_count] = record->premise_count;
+}
+
+// counting sort of the path edges by the label of the cells they touch, labels run from 1 to path_count
+void justify_segments(justify_t *justify, board_t const *board, uint const *cells, uint path_count)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint *const segment_start = justify->segment_start;
+	uint *const segment_edges = justify->segment_edges;
+
+	// segment i ends up as segment_start[i] to segment_start[i + 1]
+	memset(segment_start, 0, (path_count + 2)*sizeof(uint));
+	for (uint pass = 0; pass < 2; ++pass) {
+		for (uint y = 0; y <= height; ++y)
+		for (uint x = 0; x < width; ++x) {
+			uint const k = y*width + x;
+			if (edge_h[k] & EDGE_PATH) {
+				uint const label = cells[min(y, height - 1)*width + x];
+				if (pass == 0) {
+					++segment_start[label + 1];
+				} else {
+					segment_edges[segment_start[label]++] = k;
+				}
+			}
+		}
+		for (uint y = 0; y < height; ++y)
+		for (uint x = 0; x <= width; ++x) {
+			uint const k = y*(width + 1) + x;
+			if (edge_v[k] & EDGE_PATH) {
+				uint const label = cells[y*width + min(x, width - 1)];
+				if (pass == 0) {
+					++segment_start[label + 1];
+				} else {
+					segment_edges[segment_start[label]++] = justify->edge_count_h + k;
+				}
+			}
+		}
+		if (pass == 0) {
+			for (uint i = 1; i <= path_count + 1; ++i) {
+				segment_start[i] += segment_start[i - 1];
+			}
+		}
+	}
+
+	// filling moved each start to the start of the next segment
+	memmove(segment_start + 1, segment_start, (path_count + 1)*sizeof(uint));
+	segment_start[0] = 0;
+}
+
+void justify_premise_segment(justify_t *justify, uint index)
+{
+	for (uint i = justify->segment_start[index]; i < justify->segment_start[index + 1]; ++i) {
+		justify_premise(justify, justify->segment_edges[i]);
+	}
+}
+
+void justify_commit(justify_t *justify)
+{
+	justification_t const tmp = justify->base;
+	justify->base = justify->record;
+	justify->record = tmp;
+}
+
+void justify_rewind(justify_t *justify)
+{
+	justification_t *const record = &justify->record;
+	justification_t const *const base = &justify->base;
+	reserve_justification(record, base->event_count, base->premise_count);
+	memcpy(record->cause, base->cause, justify->edge_count*sizeof(uint));
+	memcpy(record->premise_start, base->premise_start, (base->event_count + 1)*sizeof(uint));
+	memcpy(record->premises, base->premises, base->premise_count*sizeof(uint));
+	record->event_count = base->event_count;
+	record->premise_count = base->premise_count;
+}
+
+// knock out a wall and undo every deduction that read it, or read an edge that was undone
+// events are in the order they happened, so one pass finds them all
+void justify_retract(justify_t *justify, board_t *board, uint wall)
+{
+	justification_t *const record = &justify->record;
+	uint *const cause = record->cause;
+	uint *const premise_start = record->premise_start;
+	uint *const premises = record->premises;
+	uint const edge_count_h = justify->edge_count_h;
+
+	if (justify->remap_capacity < record->event_count) {
+		free(justify->remap);
+		justify->remap_capacity = record->event_capacity;
+		justify->remap = (uint *)malloc(justify->remap_capacity*sizeof(uint));
+	}
+	uint *const remap = justify->remap;
+
+	// drop the undone events, the rest move down in place
+	uint kept_count = 0;
+	uint premise_count = 0;
+	for (uint i = 0; i < record->event_count; ++i) {
+		uint const begin = premise_start[i];
+		uint const end = premise_start[i + 1];
+		bool is_undone = false;
+		for (uint j = begin; j < end && !is_undone; ++j) {
+			uint const k = premises[j];
+			is_undone = (k == wall || (cause[k] < i && remap[cause[k]] == NO_CAUSE));
+		}
+		if (is_undone) {
+			remap[i] = NO_CAUSE;
+			continue;
+		}
+		remap[i] = kept_count;
+		premise_start[kept_count++] = premise_count;
+		memmove(premises + premise_count, premises + begin, (end - begin)*sizeof(uint));
+		premise_count += end - begin;
+	}
+	premise_start[kept_count] = premise_count;
+	record->event_count = kept_count;
+	record->premise_count = premise_count;
+
+	for (uint k = 0; k < justify->edge_count; ++k) {
+		if (cause[k] == NO_CAUSE) {
+			continue;
+		}
+		cause[k] = remap[cause[k]];
+		if (cause[k] == NO_CAUSE) {
+			uint *const e = (k < edge_count_h) ? (board->edge_h + k) : (board->edge_v + k - edge_count_h);
+			*e &= ~(EDGE_BARRIER | EDGE_PATH);
+		}
+	}
+	uint *const e = (wall < edge_count_h) ? (board->edge_h + wall) : (board->edge_v + wall - edge_count_h);
+	*e &= ~(EDGE_BOUNDARY | EDGE_BARRIER);
+}
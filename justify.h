@@ -0,0 +1,27 @@
+#pragma once
+
+#include "board.h"
+
+// records which edges each deduction read, so that removing a wall only has to undo the
+// deductions that depended on it, directly or through other deductions
+// edge ids number the horizontal edges first, then the vertical edges
+// premises only need to cover edges decided before the deduction, deductions are sound so
+// the ones kept after a retraction still hold for the board with the wall removed
+
+void init_justify(justify_t *justify, board_t const *board);
+void free_justify(justify_t *justify);
+void justify_begin(justify_t *justify, board_t const *board);
+
+// a deduction: add its premises, mark the edges it set, then end it
+void justify_premise(justify_t *justify, uint k);
+void justify_decided(justify_t *justify, uint k);
+void justify_end(justify_t *justify);
+
+// path edges by the segment labels of the loop check, then a segment's edges as premises
+void justify_segments(justify_t *justify, board_t const *board, uint const *cells, uint path_count);
+void justify_premise_segment(justify_t *justify, uint index);
+
+// keep the record as the base for later trials, or go back to the last one kept
+void justify_commit(justify_t *justify);
+void justify_rewind(justify_t *justify);
+void justify_retract(justify_t *justify, board_t *board, uint wall);
@@ -0,0 +1,219 @@
+#include "kernels.h"
+#include <string.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_X86_KERNELS
+#endif
+
+static inline
+bool is_single_cell(uint n, uint s, uint w, uint e)
+{
+	uint const barrier_count = ((n >> 1) & 1) + ((s >> 1) & 1) + ((w >> 1) & 1) + ((e >> 1) & 1);
+	uint const path_count = ((n >> 2) & 1) + ((s >> 2) & 1) + ((w >> 2) & 1) + ((e >> 2) & 1);
+	return (barrier_count == 2 && path_count < 2) || (path_count == 2 && barrier_count < 2);
+}
+
+static inline
+bool is_loop_cell(uint n, uint s, uint w, uint e, uint label)
+{
+	uint const barrier_count = ((n >> 1) & 1) + ((s >> 1) & 1) + ((w >> 1) & 1) + ((e >> 1) & 1);
+	uint const free_count = ((n & 6) == 0) + ((s & 6) == 0) + ((w & 6) == 0) + ((e & 6) == 0);
+	return label == 0 && barrier_count == 1 && free_count == 3;
+}
+
+static
+uint64_t single_cells_scalar(uint const *north, uint const *south, uint const *west, uint count)
+{
+	uint64_t mask = 0;
+	for (uint i = 0; i < count; ++i) {
+		mask |= (uint64_t)is_single_cell(north[i], south[i], west[i], west[i + 1]) << i;
+	}
+	return mask;
+}
+
+static
+uint64_t loop_cells_scalar(uint const *north, uint const *south, uint const *west, uint const *labels, uint count)
+{
+	uint64_t mask = 0;
+	for (uint i = 0; i < count; ++i) {
+		mask |= (uint64_t)is_loop_cell(north[i], south[i], west[i], west[i + 1], labels[i]) << i;
+	}
+	return mask;
+}
+
+static cell_kernels_t const scalar_kernels = { "scalar", single_cells_scalar, loop_cells_scalar };
+
+#ifdef HAS_X86_KERNELS
+
+// sums of (edge & bit) over the four edges: barrier sum is 2*count, path sum is 4*count
+__attribute__((target("sse4.2")))
+static
+uint64_t single_cells_sse42(uint const *north, uint const *south, uint const *west, uint count)
+{
+	__m128i const barrier_bit = _mm_set1_epi32(EDGE_BARRIER);
+	__m128i const path_bit = _mm_set1_epi32(EDGE_PATH);
+	uint64_t mask = 0;
+	uint i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i const n = _mm_loadu_si128((__m128i const *)(north + i));
+		__m128i const s = _mm_loadu_si128((__m128i const *)(south + i));
+		__m128i const w = _mm_loadu_si128((__m128i const *)(west + i));
+		__m128i const e = _mm_loadu_si128((__m128i const *)(west + i + 1));
+		__m128i const barrier = _mm_add_epi32(
+			_mm_add_epi32(_mm_and_si128(n, barrier_bit), _mm_and_si128(s, barrier_bit)),
+			_mm_add_epi32(_mm_and_si128(w, barrier_bit), _mm_and_si128(e, barrier_bit)));
+		__m128i const path = _mm_add_epi32(
+			_mm_add_epi32(_mm_and_si128(n, path_bit), _mm_and_si128(s, path_bit)),
+			_mm_add_epi32(_mm_and_si128(w, path_bit), _mm_and_si128(e, path_bit)));
+		__m128i const make_path = _mm_and_si128(_mm_cmpeq_epi32(barrier, _mm_set1_epi32(4)), _mm_cmplt_epi32(path, _mm_set1_epi32(8)));
+		__m128i const make_barrier = _mm_and_si128(_mm_cmpeq_epi32(path, _mm_set1_epi32(8)), _mm_cmplt_epi32(barrier, _mm_set1_epi32(4)));
+		uint const fired = (uint)_mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(make_path, make_barrier)));
+		mask |= (uint64_t)fired << i;
+	}
+	if (i < count) {
+		mask |= single_cells_scalar(north + i, south + i, west + i, count - i) << i;
+	}
+	return mask;
+}
+
+__attribute__((target("sse4.2")))
+static
+uint64_t loop_cells_sse42(uint const *north, uint const *south, uint const *west, uint const *labels, uint count)
+{
+	__m128i const barrier_bit = _mm_set1_epi32(EDGE_BARRIER);
+	__m128i const decided_bits = _mm_set1_epi32(EDGE_BARRIER | EDGE_PATH);
+	__m128i const zero = _mm_setzero_si128();
+	uint64_t mask = 0;
+	uint i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i const n = _mm_loadu_si128((__m128i const *)(north + i));
+		__m128i const s = _mm_loadu_si128((__m128i const *)(south + i));
+		__m128i const w = _mm_loadu_si128((__m128i const *)(west + i));
+		__m128i const e = _mm_loadu_si128((__m128i const *)(west + i + 1));
+		__m128i const label = _mm_loadu_si128((__m128i const *)(labels + i));
+		__m128i const barrier = _mm_add_epi32(
+			_mm_add_epi32(_mm_and_si128(n, barrier_bit), _mm_and_si128(s, barrier_bit)),
+			_mm_add_epi32(_mm_and_si128(w, barrier_bit), _mm_and_si128(e, barrier_bit)));
+		// each free edge adds -1
+		__m128i const free_count = _mm_add_epi32(
+			_mm_add_epi32(_mm_cmpeq_epi32(_mm_and_si128(n, decided_bits), zero), _mm_cmpeq_epi32(_mm_and_si128(s, decided_bits), zero)),
+			_mm_add_epi32(_mm_cmpeq_epi32(_mm_and_si128(w, decided_bits), zero), _mm_cmpeq_epi32(_mm_and_si128(e, decided_bits), zero)));
+		__m128i const is_loop = _mm_and_si128(_mm_cmpeq_epi32(label, zero),
+			_mm_and_si128(_mm_cmpeq_epi32(barrier, barrier_bit), _mm_cmpeq_epi32(free_count, _mm_set1_epi32(-3))));
+		uint const fired = (uint)_mm_movemask_ps(_mm_castsi128_ps(is_loop));
+		mask |= (uint64_t)fired << i;
+	}
+	if (i < count) {
+		mask |= loop_cells_scalar(north + i, south + i, west + i, labels + i, count - i) << i;
+	}
+	return mask;
+}
+
+__attribute__((target("avx2")))
+static
+uint64_t single_cells_avx2(uint const *north, uint const *south, uint const *west, uint count)
+{
+	__m256i const barrier_bit = _mm256_set1_epi32(EDGE_BARRIER);
+	__m256i const path_bit = _mm256_set1_epi32(EDGE_PATH);
+	uint64_t mask = 0;
+	uint i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i const n = _mm256_loadu_si256((__m256i const *)(north + i));
+		__m256i const s = _mm256_loadu_si256((__m256i const *)(south + i));
+		__m256i const w = _mm256_loadu_si256((__m256i const *)(west + i));
+		__m256i const e = _mm256_loadu_si256((__m256i const *)(west + i + 1));
+		__m256i const barrier = _mm256_add_epi32(
+			_mm256_add_epi32(_mm256_and_si256(n, barrier_bit), _mm256_and_si256(s, barrier_bit)),
+			_mm256_add_epi32(_mm256_and_si256(w, barrier_bit), _mm256_and_si256(e, barrier_bit)));
+		__m256i const path = _mm256_add_epi32(
+			_mm256_add_epi32(_mm256_and_si256(n, path_bit), _mm256_and_si256(s, path_bit)),
+			_mm256_add_epi32(_mm256_and_si256(w, path_bit), _mm256_and_si256(e, path_bit)));
+		__m256i const make_path = _mm256_and_si256(_mm256_cmpeq_epi32(barrier, _mm256_set1_epi32(4)), _mm256_cmpgt_epi32(_mm256_set1_epi32(8), path));
+		__m256i const make_barrier = _mm256_and_si256(_mm256_cmpeq_epi32(path, _mm256_set1_epi32(8)), _mm256_cmpgt_epi32(_mm256_set1_epi32(4), barrier));
+		uint const fired = (uint)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(make_path, make_barrier)));
+		mask |= (uint64_t)fired << i;
+	}
+	if (i < count) {
+		mask |= single_cells_sse42(north + i, south + i, west + i, count - i) << i;
+	}
+	return mask;
+}
+
+__attribute__((target("avx2")))
+static
+uint64_t loop_cells_avx2(uint const *north, uint const *south, uint const *west, uint const *labels, uint count)
+{
+	__m256i const barrier_bit = _mm256_set1_epi32(EDGE_BARRIER);
+	__m256i const decided_bits = _mm256_set1_epi32(EDGE_BARRIER | EDGE_PATH);
+	__m256i const zero = _mm256_setzero_si256();
+	uint64_t mask = 0;
+	uint i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i const n = _mm256_loadu_si256((__m256i const *)(north + i));
+		__m256i const s = _mm256_loadu_si256((__m256i const *)(south + i));
+		__m256i const w = _mm256_loadu_si256((__m256i const *)(west + i));
+		__m256i const e = _mm256_loadu_si256((__m256i const *)(west + i + 1));
+		__m256i const label = _mm256_loadu_si256((__m256i const *)(labels + i));
+		__m256i const barrier = _mm256_add_epi32(
+			_mm256_add_epi32(_mm256_and_si256(n, barrier_bit), _mm256_and_si256(s, barrier_bit)),
+			_mm256_add_epi32(_mm256_and_si256(w, barrier_bit), _mm256_and_si256(e, barrier_bit)));
+		__m256i const free_count = _mm256_add_epi32(
+			_mm256_add_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(n, decided_bits), zero), _mm256_cmpeq_epi32(_mm256_and_si256(s, decided_bits), zero)),
+			_mm256_add_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(w, decided_bits), zero), _mm256_cmpeq_epi32(_mm256_and_si256(e, decided_bits), zero)));
+		__m256i const is_loop = _mm256_and_si256(_mm256_cmpeq_epi32(label, zero),
+			_mm256_and_si256(_mm256_cmpeq_epi32(barrier, barrier_bit), _mm256_cmpeq_epi32(free_count, _mm256_set1_epi32(-3))));
+		uint const fired = (uint)_mm256_movemask_ps(_mm256_castsi256_ps(is_loop));
+		mask |= (uint64_t)fired << i;
+	}
+	if (i < count) {
+		mask |= loop_cells_sse42(north + i, south + i, west + i, labels + i, count - i) << i;
+	}
+	return mask;
+}
+
+static cell_kernels_t const sse42_kernels = { "sse4.2", single_cells_sse42, loop_cells_sse42 };
+static cell_kernels_t const avx2_kernels = { "avx2", single_cells_avx2, loop_cells_avx2 };
+
+#endif
+
+static cell_kernels_t const *selected_kernels = &scalar_kernels;
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+
+// widest kernels the cpu supports, checked once
+static
+void select_kernels(void)
+{
+#ifdef HAS_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		selected_kernels = &avx2_kernels;
+	} else if (__builtin_cpu_supports("sse4.2")) {
+		selected_kernels = &sse42_kernels;
+	}
+#endif
+}
+
+cell_kernels_t const *default_cell_kernels(void)
+{
+	pthread_once(&select_once, select_kernels);
+	return selected_kernels;
+}
+
+// kernels by name if this cpu can run them, for comparing against the default
+cell_kernels_t const *find_cell_kernels(char const *name)
+{
+	if (strcmp(name, scalar_kernels.name) == 0) {
+		return &scalar_kernels;
+	}
+#ifdef HAS_X86_KERNELS
+	__builtin_cpu_init();
+	if (strcmp(name, sse42_kernels.name) == 0 && __builtin_cpu_supports("sse4.2")) {
+		return &sse42_kernels;
+	}
+	if (strcmp(name, avx2_kernels.name) == 0 && __builtin_cpu_supports("avx2")) {
+		return &avx2_kernels;
+	}
+#endif
+	return NULL;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "board.h"
+
+// row kernels that find the cells a rule may fire on, up to 64 cells starting at north[0]
+// north and south are the horizontal edges above and below the cells, west the vertical
+// edges to their left (the east edges are west + 1), the result has bit i set for cell i
+// the rules re-check each candidate in order, so results match checking every cell
+typedef struct cell_kernels_t
+{
+	char const *name;
+	// available == 2 && path < 2, or path == 2 && available > 2
+	uint64_t (*single_cells)(uint const *north, uint const *south, uint const *west, uint count);
+	// unlabelled cells with one barrier and three undecided edges
+	uint64_t (*loop_cells)(uint const *north, uint const *south, uint const *west, uint const *labels, uint count);
+} cell_kernels_t;
+
+cell_kernels_t const *default_cell_kernels(void);
+cell_kernels_t const *find_cell_kernels(char const *name);
@@ -0,0 +1,48 @@
+#include "mt19937.h"
+
+// after the reference implementation by Makoto Matsumoto and Takuji Nishimura
+#define MT_N			624
+#define MT_M			397
+#define MT_MATRIX_A		0x9908b0dfU
+#define MT_UPPER_MASK	0x80000000U
+#define MT_LOWER_MASK	0x7fffffffU
+
+void init_genrand(mt_state_t *state, unsigned long s)
+{
+	uint32_t *const mt = state->mt;
+	mt[0] = (uint32_t)s;
+	for (uint i = 1; i < MT_N; ++i) {
+		mt[i] = 1812433253U*(mt[i - 1] ^ (mt[i - 1] >> 30)) + i;
+	}
+	state->index = MT_N;
+}
+
+static inline
+uint32_t twist(uint32_t a, uint32_t b, uint32_t c)
+{
+	uint32_t const y = (a & MT_UPPER_MASK) | (b & MT_LOWER_MASK);
+	return c ^ (y >> 1) ^ ((y & 1) ? MT_MATRIX_A : 0);
+}
+
+unsigned long genrand_int32(mt_state_t *state)
+{
+	uint32_t *const mt = state->mt;
+	if (state->index >= MT_N) {
+		uint k = 0;
+		for (; k < MT_N - MT_M; ++k) {
+			mt[k] = twist(mt[k], mt[k + 1], mt[k + MT_M]);
+		}
+		for (; k < MT_N - 1; ++k) {
+			mt[k] = twist(mt[k], mt[k + 1], mt[k + MT_M - MT_N]);
+		}
+		mt[MT_N - 1] = twist(mt[MT_N - 1], mt[0], mt[MT_M - 1]);
+		state->index = 0;
+	}
+
+	uint32_t y = mt[state->index++];
+	y ^= (y >> 11);
+	y ^= (y << 7) & 0x9d2c5680U;
+	y ^= (y << 15) & 0xefc60000U;
+	y ^= (y >> 18);
+	return y;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "board.h"
+
+// Mersenne Twister (MT19937) with explicit state so that each thread or trial can own one
+typedef struct
+{
+	uint32_t mt[624];
+	uint index;
+} mt_state_t;
+
+void init_genrand(mt_state_t *state, unsigned long s);
+unsigned long genrand_int32(mt_state_t *state);
@@ -0,0 +1,251 @@
+#include "rounds.h"
+#include "solver.h"
+#include "stats.h"
+#include "trace.h"
+#include "io.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct
+{
+	solver_t solver;		// private scratch, the parity cache carries over between rounds
+	stats_t stats;			// parity block counts, added to the caller's after each round
+	board_t board;			// the round's board plus this rule's deductions
+	step_t step;
+	bool is_solved;
+	uint64_t cycle_count;
+} rule_run_t;
+
+struct round_pool_t;
+
+typedef struct
+{
+	struct round_pool_t *pool;
+	uint index;
+	pthread_t thread;
+} rounder_t;
+
+typedef struct round_pool_t
+{
+	uint thread_count;		// thread i runs rules i, i + thread_count, ..., the caller is thread 0
+	rounder_t rounders[RULE_COUNT];
+	rule_run_t runs[RULE_COUNT];
+	pthread_mutex_t lock;
+	pthread_cond_t round_start;
+	pthread_cond_t round_done;
+	uint round;				// incremented to start each round
+	uint pending_count;
+	bool is_finished;
+	solver_t const *solver;	// round in progress, only read by the threads
+	board_t const *board;
+} round_pool_t;
+
+static
+void run_round_rule(round_pool_t *pool, rule_t rule)
+{
+	rule_run_t *const run = pool->runs + rule;
+	board_t const *const board = pool->board;
+	solver_t const *const parent = pool->solver;
+
+	if (run->board.width != board->width || run->board.height != board->height) {
+		free_board(&run->board);
+		copy_board(&run->board, board);
+	} else {
+		copy_board_edges(&run->board, board);
+	}
+	reserve_solver(&run->solver, board);
+	run->solver.kernels = parent->kernels;
+	run->solver.stats = parent->stats ? &run->stats : NULL;
+	if (run->solver.stats) {
+		reserve_stats(run->solver.stats, board);
+	}
+
+	uint64_t const start = read_cycles();
+	run->step = run_rule(&run->solver, &run->board, rule, &run->is_solved);
+	run->cycle_count = read_cycles() - start;
+}
+
+static
+void run_rounder(rounder_t *rounder)
+{
+	round_pool_t *const pool = rounder->pool;
+	for (uint rule = rounder->index; rule < RULE_COUNT; rule += pool->thread_count) {
+		run_round_rule(pool, (rule_t)rule);
+	}
+}
+
+static
+void *rounder_main(void *arg)
+{
+	rounder_t *const rounder = (rounder_t *)arg;
+	round_pool_t *const pool = rounder->pool;
+	uint round = 0;
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		while (pool->round == round && !pool->is_finished) {
+			pthread_cond_wait(&pool->round_start, &pool->lock);
+		}
+		bool const is_finished = pool->is_finished;
+		round = pool->round;
+		pthread_mutex_unlock(&pool->lock);
+		if (is_finished) {
+			break;
+		}
+
+		run_rounder(rounder);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->pending_count == 0) {
+			pthread_cond_signal(&pool->round_done);
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return NULL;
+}
+
+struct round_pool_t *create_round_pool(board_t const *board, uint thread_count)
+{
+	round_pool_t *const pool = (round_pool_t *)calloc(1, sizeof(round_pool_t));
+	pool->thread_count = min(max(thread_count, 1), RULE_COUNT);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->round_start, NULL);
+	pthread_cond_init(&pool->round_done, NULL);
+	for (uint rule = 0; rule < RULE_COUNT; ++rule) {
+		rule_run_t *const run = pool->runs + rule;
+		init_solver(&run->solver, board);
+		init_stats(&run->stats);
+		copy_board(&run->board, board);
+	}
+	for (uint i = 0; i < pool->thread_count; ++i) {
+		rounder_t *const rounder = pool->rounders + i;
+		rounder->pool = pool;
+		rounder->index = i;
+		if (i > 0) {
+			pthread_create(&rounder->thread, NULL, rounder_main, rounder);
+		}
+	}
+	return pool;
+}
+
+void destroy_round_pool(struct round_pool_t *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->is_finished = true;
+	pthread_cond_broadcast(&pool->round_start);
+	pthread_mutex_unlock(&pool->lock);
+	for (uint i = 1; i < pool->thread_count; ++i) {
+		pthread_join(pool->rounders[i].thread, NULL);
+	}
+	for (uint rule = 0; rule < RULE_COUNT; ++rule) {
+		rule_run_t *const run = pool->runs + rule;
+		free_solver(&run->solver);
+		free_stats(&run->stats);
+		free_board(&run->board);
+	}
+	pthread_cond_destroy(&pool->round_done);
+	pthread_cond_destroy(&pool->round_start);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+static
+void run_round(round_pool_t *pool, solver_t const *solver, board_t const *board)
+{
+	pool->solver = solver;
+	pool->board = board;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->pending_count = pool->thread_count - 1;
+	++pool->round;
+	pthread_cond_broadcast(&pool->round_start);
+	pthread_mutex_unlock(&pool->lock);
+
+	run_rounder(pool->rounders);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->pending_count != 0) {
+		pthread_cond_wait(&pool->round_done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+// adds one rule's new paths and barriers, an edge proposed as both is a contradiction
+static
+uint merge_edges(solver_t const *solver, board_t const *board, board_t const *proposed, bool *is_conflict)
+{
+	uint const edge_count_h = board->width*(board->height + 1);
+	uint const edge_count = edge_count_h + (board->width + 1)*board->height;
+	uint change_count = 0;
+	for (uint k = 0; k < edge_count; ++k) {
+		uint const edge = (k < edge_count_h) ? board->edge_h[k] : board->edge_v[k - edge_count_h];
+		uint const proposed_edge = (k < edge_count_h) ? proposed->edge_h[k] : proposed->edge_v[k - edge_count_h];
+		uint const bits = proposed_edge & ~edge & (EDGE_PATH | EDGE_BARRIER);
+		if (bits == 0) {
+			continue;
+		}
+		if (((edge | bits) & (EDGE_PATH | EDGE_BARRIER)) == (EDGE_PATH | EDGE_BARRIER)) {
+			*is_conflict = true;
+		}
+		decide_edge(solver, board, k, bits);
+		++change_count;
+	}
+	return change_count;
+}
+
+uint solve_rounds(solver_t const *solver, board_t const *board, solve_status_t *status)
+{
+	round_pool_t *const pool = solver->rounds;
+	stats_t *const stats = solver->stats;
+
+	bool is_solved = false;
+	bool is_contradiction = false;
+	uint step_count = 0;
+	for (;;) {
+		if (solver->verbose) {
+			copy_edges_to_solver(solver, board);
+		}
+		run_round(pool, solver, board);
+
+		// in rule order, each rule is counted for the edges no earlier rule set
+		uint change_count = 0;
+		for (uint rule = 0; rule < RULE_COUNT; ++rule) {
+			rule_run_t *const run = pool->runs + rule;
+			is_contradiction |= (run->step == STEP_CONTRADICTION);
+			uint const rule_change_count = merge_edges(solver, board, &run->board, &is_contradiction);
+			change_count += rule_change_count;
+			if (rule_change_count > 0 && solver->trace) {
+				trace_step(solver->trace, board, (rule_t)rule);
+			}
+			if (stats) {
+				rule_stats_t *const rule_stats = stats->rules + rule;
+				++rule_stats->call_count;
+				rule_stats->cycle_count += run->cycle_count;
+				rule_stats->success_count += (rule_change_count > 0);
+				rule_stats->edge_count += stats->decided_count;
+				stats->decided_count = 0;
+				drain_stats(stats, &run->stats);
+			}
+		}
+		if (is_contradiction) {
+			break;
+		}
+		if (change_count == 0) {
+			is_solved = pool->runs[RULE_LOOPS].is_solved;
+			break;
+		}
+		++step_count;
+		if (solver->verbose) {
+			printf("\nround %u:\n", step_count);
+			print_board(solver, board, EDGE_ALL | EDGE_NEW);
+		}
+	}
+	*status = is_contradiction ? SOLVE_CONTRADICTION : is_solved ? SOLVE_SOLVED : SOLVE_GIVEN_UP;
+	if (stats) {
+		stats->step_count += step_count;
+	}
+	if (solver->trace) {
+		trace_end(solver->trace, *status, step_count);
+	}
+	return step_count;
+}
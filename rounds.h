@@ -0,0 +1,13 @@
+#pragma once
+
+#include "board.h"
+
+// synchronous rounds: every rule makes a single pass over a private copy of the same board,
+// then the new paths and barriers are merged into the board in rule order
+// rules only read the board the round started from, so they run on separate threads and the
+// result does not depend on the thread count, a round that changes nothing ends the solve at
+// the same fixed point as solve, conflicting deductions mean the board was contradictory
+
+struct round_pool_t *create_round_pool(board_t const *board, uint thread_count);
+void destroy_round_pool(struct round_pool_t *pool);
+uint solve_rounds(solver_t const *solver, board_t const *board, solve_status_t *status);
@@ -0,0 +1,107 @@
+#include "schedule.h"
+#include <stdlib.h>
+#include <memory.h>
+
+// cycles per cell, queued edge or block visited, roughly as measured
+#define SINGLE_CELL_CYCLES	20
+#define LOOP_CELL_CYCLES	150
+#define PARTITION_CELL_CYCLES	80
+#define PARITY_BLOCK_CYCLES	500
+
+static
+uint64_t visit_cycles(uint task)
+{
+	return (task == RULE_SINGLE_CELLS) ? SINGLE_CELL_CYCLES : (task == RULE_LOOPS) ? LOOP_CELL_CYCLES : (task == RULE_PARTITIONS) ? PARTITION_CELL_CYCLES : PARITY_BLOCK_CYCLES;
+}
+
+void init_schedule(schedule_t *schedule)
+{
+	memset(schedule, 0, sizeof(schedule_t));
+}
+
+void free_schedule(schedule_t *schedule)
+{
+	free(schedule->tasks);
+	memset(schedule, 0, sizeof(schedule_t));
+}
+
+uint parity_task(schedule_t const *schedule, uint w, uint h)
+{
+	return RULE_PARITY + (h - 2)*(schedule->width - 1) + (w - 2);
+}
+
+void parity_task_size(schedule_t const *schedule, uint task, uint *w, uint *h)
+{
+	uint const i = task - RULE_PARITY;
+	*w = i % (schedule->width - 1) + 2;
+	*h = i/(schedule->width - 1) + 2;
+}
+
+// estimates carry over between solves of boards the same size, other sizes start over
+void begin_schedule(schedule_t *schedule, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	if (width != schedule->width || height != schedule->height) {
+		uint const task_count = RULE_PARITY + ((width > 1 && height > 1) ? (width - 1)*(height - 1) : 0);
+		if (task_count > schedule->task_capacity) {
+			free(schedule->tasks);
+			schedule->tasks = (schedule_task_t *)malloc(task_count*sizeof(schedule_task_t));
+			schedule->task_capacity = task_count;
+		}
+		schedule->width = width;
+		schedule->height = height;
+		schedule->task_count = task_count;
+
+		// one edge per call at the cost of a full scan
+		uint64_t const cell_count = width*height;
+		for (uint task = 0; task < RULE_PARITY; ++task) {
+			schedule->tasks[task].cost = visit_cycles(task)*cell_count;
+		}
+		for (uint task = RULE_PARITY; task < task_count; ++task) {
+			uint w, h;
+			parity_task_size(schedule, task, &w, &h);
+			schedule->tasks[task].cost = visit_cycles(task)*(uint64_t)(width - w + 1)*(height - h + 1);
+		}
+		for (uint task = 0; task < task_count; ++task) {
+			schedule->tasks[task].yield = 256;
+		}
+	}
+	for (uint task = 0; task < schedule->task_count; ++task) {
+		schedule->tasks[task].clean = 0;
+	}
+	schedule->generation = 1;
+	schedule->parity_generation = 0;
+}
+
+// the task not yet run on this board with the most edges per cycle, ties go to the fixed order
+uint next_task(schedule_t const *schedule)
+{
+	schedule_task_t const *const tasks = schedule->tasks;
+	uint best = NO_TASK;
+	for (uint task = 0; task < schedule->task_count; ++task) {
+		if (tasks[task].clean == schedule->generation) {
+			continue;
+		}
+		if (best == NO_TASK || (tasks[task].yield + 1)*tasks[best].cost > (tasks[best].yield + 1)*tasks[task].cost) {
+			best = task;
+		}
+	}
+	return best;
+}
+
+// moving averages over the last eight or so calls, edge_count is zero only if nothing changed
+void end_task(schedule_t *schedule, uint task, uint64_t visit_count, uint edge_count)
+{
+	schedule_task_t *const t = schedule->tasks + task;
+	t->cost = t->cost - t->cost/8 + visit_cycles(task)*visit_count/8;
+	if (t->cost == 0) {
+		t->cost = 1;
+	}
+	t->yield = t->yield - t->yield/8 + 32*(uint64_t)edge_count;
+	if (edge_count == 0) {
+		t->clean = schedule->generation;
+	} else {
+		++schedule->generation;
+	}
+}
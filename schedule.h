@@ -0,0 +1,18 @@
+#pragma once
+
+#include "board.h"
+
+// picks the next rule to run from the edges each has decided per estimated cycle so far
+// costs come from the cells or blocks each call looked at rather than timings, so runs repeat exactly
+// every task runs again after any edge changes before solve stops, so it stops where
+// none of them apply, the same place as the fixed order since rules only ever add edges
+// tasks are the rules before parity by rule_t, then each parity block size
+
+void init_schedule(schedule_t *schedule);
+void free_schedule(schedule_t *schedule);
+void begin_schedule(schedule_t *schedule, board_t const *board);
+uint next_task(schedule_t const *schedule);
+void end_task(schedule_t *schedule, uint task, uint64_t visit_count, uint edge_count);
+
+uint parity_task(schedule_t const *schedule, uint w, uint h);
+void parity_task_size(schedule_t const *schedule, uint task, uint *w, uint *h);
@@ -0,0 +1,271 @@
+#include "search.h"
+#include "solver.h"
+#include <stdlib.h>
+#include <memory.h>
+
+typedef struct
+{
+	uint edge;			// edge id, vertical edges after all horizontal ones
+	uint old_bits;
+} trail_entry_t;
+
+typedef struct
+{
+	uint edge;			// edge branched on
+	uint trail_mark;	// trail length before the branch was applied
+	bool tried_barrier;
+} search_frame_t;
+
+typedef struct
+{
+	board_t const *board;
+	uint edge_count_h;
+	uint edge_count;
+	uint *shadow;		// edges as of the last trail sync, same id order
+	trail_entry_t *trail;
+	uint trail_count;
+	uint trail_capacity;
+} trail_t;
+
+static
+uint *edge_bits(board_t const *board, uint edge_count_h, uint k)
+{
+	return (k < edge_count_h) ? (board->edge_h + k) : (board->edge_v + k - edge_count_h);
+}
+
+static
+void push_trail(trail_t *trail, uint k, uint old_bits)
+{
+	if (trail->trail_count == trail->trail_capacity) {
+		trail->trail_capacity *= 2;
+		trail->trail = (trail_entry_t *)realloc(trail->trail, trail->trail_capacity*sizeof(trail_entry_t));
+	}
+	trail_entry_t *const entry = trail->trail + trail->trail_count++;
+	entry->edge = k;
+	entry->old_bits = old_bits;
+}
+
+// record every edge the rules changed since the last sync
+static
+void sync_trail(trail_t *trail)
+{
+	for (uint k = 0; k < trail->edge_count; ++k) {
+		uint const bits = *edge_bits(trail->board, trail->edge_count_h, k);
+		if (bits != trail->shadow[k]) {
+			push_trail(trail, k, trail->shadow[k]);
+			trail->shadow[k] = bits;
+		}
+	}
+}
+
+static
+void undo_trail(trail_t *trail, uint mark)
+{
+	while (trail->trail_count > mark) {
+		trail_entry_t const *const entry = trail->trail + --trail->trail_count;
+		*edge_bits(trail->board, trail->edge_count_h, entry->edge) = entry->old_bits;
+		trail->shadow[entry->edge] = entry->old_bits;
+	}
+}
+
+static
+void set_edge(trail_t *trail, uint k, uint bits)
+{
+	uint *const e = edge_bits(trail->board, trail->edge_count_h, k);
+	push_trail(trail, k, *e);
+	*e |= bits;
+	trail->shadow[k] = *e;
+}
+
+// checks the rules cannot see: conflicting edges, cell degrees, path exits and closed loops
+static
+bool is_consistent(solver_t const *solver, board_t const *board, bool *is_complete)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint *const parent = solver->tmp1;
+
+	*is_complete = true;
+	uint exit_count = 0;
+	for (uint y = 0; y < height; ++y)
+	for (uint x = 0; x < width; ++x) {
+		uint const e[4] = {
+			edge_h[y*width + x],
+			edge_h[(y + 1)*width + x],
+			edge_v[y*(width + 1) + x],
+			edge_v[y*(width + 1) + x + 1]
+		};
+		uint available_count = 0;
+		uint path_count = 0;
+		for (uint i = 0; i < 4; ++i) {
+			if ((e[i] & (EDGE_PATH | EDGE_BARRIER)) == (EDGE_PATH | EDGE_BARRIER)) {
+				return false;
+			}
+			if ((e[i] & EDGE_BARRIER) == 0) {
+				++available_count;
+			}
+			if (e[i] & EDGE_PATH) {
+				++path_count;
+			}
+		}
+		if (path_count > 2 || available_count < 2) {
+			return false;
+		}
+		if (path_count < 2) {
+			*is_complete = false;
+		}
+		parent[y*width + x] = y*width + x;
+	}
+	for (uint x = 0; x < width; ++x) {
+		exit_count += ((edge_h[x] & EDGE_PATH) != 0) + ((edge_h[height*width + x] & EDGE_PATH) != 0);
+	}
+	for (uint y = 0; y < height; ++y) {
+		exit_count += ((edge_v[y*(width + 1)] & EDGE_PATH) != 0) + ((edge_v[y*(width + 1) + width] & EDGE_PATH) != 0);
+	}
+	if (exit_count > 2) {
+		return false;
+	}
+
+	// a path edge joining two cells already connected closes a loop
+	for (uint y = 0; y < height; ++y)
+	for (uint x = 0; x < width; ++x) {
+		uint const i = y*width + x;
+		if (x + 1 < width && (edge_v[y*(width + 1) + x + 1] & EDGE_PATH)) {
+			uint const a = find_root(parent, i);
+			uint const b = find_root(parent, i + 1);
+			if (a == b) {
+				return false;
+			}
+			parent[a] = b;
+		}
+		if (y + 1 < height && (edge_h[(y + 1)*width + x] & EDGE_PATH)) {
+			uint const a = find_root(parent, i);
+			uint const b = find_root(parent, i + width);
+			if (a == b) {
+				return false;
+			}
+			parent[a] = b;
+		}
+	}
+	return true;
+}
+
+// branch next to the end of a path where possible, on the cell with fewest choices
+static
+uint choose_edge(board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const edge_count_h = width*(height + 1);
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+
+	uint best_edge = NOT_ON_PATH;
+	uint best_score = ~0U;
+	for (uint y = 0; y < height; ++y)
+	for (uint x = 0; x < width; ++x) {
+		uint const k[4] = {
+			y*width + x,
+			(y + 1)*width + x,
+			edge_count_h + y*(width + 1) + x,
+			edge_count_h + y*(width + 1) + x + 1
+		};
+		uint path_count = 0;
+		uint open_count = 0;
+		uint open_edge = 0;
+		for (uint i = 0; i < 4; ++i) {
+			uint const e = (k[i] < edge_count_h) ? edge_h[k[i]] : edge_v[k[i] - edge_count_h];
+			if (e & EDGE_PATH) {
+				++path_count;
+			} else if ((e & EDGE_BARRIER) == 0) {
+				if (open_count == 0) {
+					open_edge = k[i];
+				}
+				++open_count;
+			}
+		}
+		if (open_count == 0) {
+			continue;
+		}
+		uint const score = ((path_count == 1) ? 0 : 4) + open_count;
+		if (score < best_score) {
+			best_score = score;
+			best_edge = open_edge;
+		}
+	}
+	return best_edge;
+}
+
+uint count_solutions(solver_t const *solver, board_t const *board, uint cap, board_t *solution, search_result_t *result)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+
+	trail_t trail;
+	memset(&trail, 0, sizeof(trail_t));
+	trail.board = board;
+	trail.edge_count_h = width*(height + 1);
+	trail.edge_count = trail.edge_count_h + (width + 1)*height;
+	trail.shadow = (uint *)malloc(trail.edge_count*sizeof(uint));
+	memcpy(trail.shadow, board->edge_h, trail.edge_count_h*sizeof(uint));
+	memcpy(trail.shadow + trail.edge_count_h, board->edge_v, (width + 1)*height*sizeof(uint));
+	trail.trail_capacity = 2*trail.edge_count;
+	trail.trail = (trail_entry_t *)malloc(trail.trail_capacity*sizeof(trail_entry_t));
+
+	// at most one frame per edge since each branch decides an undecided edge
+	search_frame_t *const frames = (search_frame_t *)malloc(trail.edge_count*sizeof(search_frame_t));
+	uint frame_count = 0;
+
+	memset(result, 0, sizeof(search_result_t));
+	result->is_exhausted = true;
+	for (;;) {
+		// propagate with the existing rules
+		++result->node_count;
+		solve_status_t status;
+		solve(solver, board, &status);
+		sync_trail(&trail);
+
+		bool is_complete = false;
+		bool const is_open = (status != SOLVE_CONTRADICTION) && is_consistent(solver, board, &is_complete);
+		uint const edge = (is_open && status != SOLVE_SOLVED && !is_complete) ? choose_edge(board) : NOT_ON_PATH;
+		if (is_open && edge == NOT_ON_PATH) {
+			// every cell has two path edges or the rules found the full path
+			if (result->solution_count == 0 && solution) {
+				copy_board_edges(solution, board);
+			}
+			if (++result->solution_count == cap) {
+				result->is_exhausted = false;
+				break;
+			}
+		}
+		if (is_open && edge != NOT_ON_PATH) {
+			search_frame_t *const frame = frames + frame_count++;
+			frame->edge = edge;
+			frame->trail_mark = trail.trail_count;
+			frame->tried_barrier = false;
+			set_edge(&trail, edge, EDGE_PATH);
+			continue;
+		}
+
+		// backtrack to the most recent branch with an untried side
+		while (frame_count > 0 && frames[frame_count - 1].tried_barrier) {
+			--frame_count;
+		}
+		if (frame_count == 0) {
+			break;
+		}
+		search_frame_t *const frame = frames + frame_count - 1;
+		undo_trail(&trail, frame->trail_mark);
+		frame->tried_barrier = true;
+		set_edge(&trail, frame->edge, EDGE_BARRIER);
+	}
+
+	// leave the board as it was given
+	undo_trail(&trail, 0);
+	free(frames);
+	free(trail.trail);
+	free(trail.shadow);
+	return result->solution_count;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "board.h"
+
+typedef struct
+{
+	uint solution_count;
+	uint node_count;		// number of times the rules were run
+	bool is_exhausted;		// false if the search stopped at the cap, so there may be more
+} search_result_t;
+
+// branch on undecided edges using the rules to propagate, board is restored afterwards
+// stops once cap solutions are found (0 for no cap), the first is copied to solution if not NULL
+uint count_solutions(solver_t const *solver, board_t const *board, uint cap, board_t *solution, search_result_t *result);
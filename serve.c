@@ -0,0 +1,453 @@
+#define _POSIX_C_SOURCE 200809L
+#include "serve.h"
+#include "solver.h"
+#include "bitboard.h"
+#include "corpus.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SKIP_CHUNK_SIZE		(1U << 16)
+
+struct server_t;
+
+typedef struct
+{
+	struct server_t *server;
+	int in_fd;
+	int out_fd;
+	bool is_owner;			// close the socket once the last response is written
+	bool is_broken;			// a write failed, later responses are dropped
+	uint ref_count;			// reader plus requests in flight, guarded by the server lock
+	pthread_mutex_t write_lock;
+} connection_t;
+
+typedef struct request_t
+{
+	struct request_t *next;	// queue or free list link
+	connection_t *connection;
+	uint id;
+	bool is_valid;
+	board_t board;			// edge storage is reused when the request is recycled
+	uint8_t *buffer;		// request bits, then the response
+	size_t buffer_capacity;
+} request_t;
+
+typedef struct
+{
+	struct server_t *server;
+	pthread_t thread;
+	solver_t solver;		// warm scratch space private to this worker
+	bitboard_t bitboard;
+	worklist_t worklist;
+} worker_t;
+
+typedef struct server_t
+{
+	serve_options_t options;
+	uint worker_count;
+	worker_t *workers;
+	uint window;			// number of requests, bounds how far readers run ahead of the workers
+	request_t *request_storage;
+	pthread_mutex_t lock;	// guards everything below and connection ref counts
+	pthread_cond_t request_ready;
+	pthread_cond_t request_free;
+	request_t *free_requests;
+	uint free_count;
+	request_t *queue_head;
+	request_t *queue_tail;
+	bool is_stopping;
+} server_t;
+
+static
+uint get_u32(uint8_t const *p)
+{
+	return (uint)p[0] | ((uint)p[1] << 8) | ((uint)p[2] << 16) | ((uint)p[3] << 24);
+}
+
+static
+void put_u32(uint8_t *p, uint value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+static
+bool read_all(int fd, uint8_t *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t const n = read(fd, data, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+static
+bool write_all(int fd, uint8_t const *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t const n = write(fd, data, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+static
+void reserve_buffer(request_t *request, size_t size)
+{
+	if (size > request->buffer_capacity) {
+		request->buffer_capacity = size;
+		request->buffer = (uint8_t *)realloc(request->buffer, size);
+	}
+}
+
+// caller holds the server lock
+static
+void release_connection(connection_t *connection)
+{
+	if (--connection->ref_count == 0) {
+		if (connection->is_owner) {
+			close(connection->in_fd);
+		}
+		pthread_mutex_destroy(&connection->write_lock);
+		free(connection);
+	}
+}
+
+static
+request_t *alloc_request(server_t *server)
+{
+	pthread_mutex_lock(&server->lock);
+	while (!server->free_requests) {
+		pthread_cond_wait(&server->request_free, &server->lock);
+	}
+	request_t *const request = server->free_requests;
+	server->free_requests = request->next;
+	--server->free_count;
+	pthread_mutex_unlock(&server->lock);
+	return request;
+}
+
+static
+void release_request(server_t *server, request_t *request)
+{
+	pthread_mutex_lock(&server->lock);
+	if (request->connection) {
+		release_connection(request->connection);
+		request->connection = NULL;
+	}
+	request->next = server->free_requests;
+	server->free_requests = request;
+	++server->free_count;
+	pthread_cond_broadcast(&server->request_free);
+	pthread_mutex_unlock(&server->lock);
+}
+
+static
+void submit_request(server_t *server, request_t *request)
+{
+	pthread_mutex_lock(&server->lock);
+	++request->connection->ref_count;
+	request->next = NULL;
+	if (server->queue_tail) {
+		server->queue_tail->next = request;
+	} else {
+		server->queue_head = request;
+	}
+	server->queue_tail = request;
+	pthread_cond_signal(&server->request_ready);
+	pthread_mutex_unlock(&server->lock);
+}
+
+static
+request_t *take_request(server_t *server)
+{
+	pthread_mutex_lock(&server->lock);
+	while (!server->queue_head && !server->is_stopping) {
+		pthread_cond_wait(&server->request_ready, &server->lock);
+	}
+	request_t *const request = server->queue_head;
+	if (request) {
+		server->queue_head = request->next;
+		if (!server->queue_head) {
+			server->queue_tail = NULL;
+		}
+	}
+	pthread_mutex_unlock(&server->lock);
+	return request;
+}
+
+// solve, then answer on the connection the request came from
+static
+void handle_request(worker_t *worker, request_t *request)
+{
+	board_t *const board = &request->board;
+	uint status = SERVE_INVALID;
+	uint step_count = 0;
+	uint width = 0;
+	uint height = 0;
+	if (request->is_valid) {
+		solve_status_t solve_status;
+		reserve_solver(&worker->solver, board);
+		step_count = solve(&worker->solver, board, &solve_status);
+		status = solve_status;
+		width = board->width;
+		height = board->height;
+	}
+
+	size_t const bit_bytes = request->is_valid ? edge_bits_size(width, height) : 0;
+	size_t const size = SERVE_HEADER_SIZE + SERVE_RESPONSE_SIZE + bit_bytes;
+	reserve_buffer(request, size);
+	uint8_t *const p = request->buffer;
+	put_u32(p, (uint)(size - SERVE_HEADER_SIZE));
+	put_u32(p + 4, request->id);
+	put_u32(p + 8, status);
+	put_u32(p + 12, step_count);
+	put_u32(p + 16, width);
+	put_u32(p + 20, height);
+	if (request->is_valid) {
+		pack_edge_bits(p + SERVE_HEADER_SIZE + SERVE_RESPONSE_SIZE, board, EDGE_PATH);
+	}
+
+	connection_t *const connection = request->connection;
+	pthread_mutex_lock(&connection->write_lock);
+	if (!connection->is_broken && !write_all(connection->out_fd, p, size)) {
+		connection->is_broken = true;
+	}
+	pthread_mutex_unlock(&connection->write_lock);
+}
+
+static
+void *worker_main(void *arg)
+{
+	worker_t *const worker = (worker_t *)arg;
+	server_t *const server = worker->server;
+	for (request_t *request; (request = take_request(server)) != NULL;) {
+		handle_request(worker, request);
+		release_request(server, request);
+	}
+	return NULL;
+}
+
+// read requests until the peer closes its end or sends something that is not a request
+static
+void read_requests(server_t *server, connection_t *connection)
+{
+	for (;;) {
+		uint8_t header[SERVE_HEADER_SIZE + SERVE_REQUEST_SIZE];
+		if (!read_all(connection->in_fd, header, sizeof(header))) {
+			break;
+		}
+		uint const size = get_u32(header);
+		if (size < SERVE_REQUEST_SIZE) {
+			fprintf(stderr, "malformed request, closing connection\n");
+			break;
+		}
+		uint const width = get_u32(header + 8);
+		uint const height = get_u32(header + 12);
+		size_t const bit_bytes = size - SERVE_REQUEST_SIZE;
+
+		request_t *const request = alloc_request(server);
+		request->connection = connection;
+		request->id = get_u32(header + 4);
+		request->is_valid = width != 0 && height != 0 && is_board_size_supported(width, height)
+			&& bit_bytes == edge_bits_size(width, height);
+
+		// bits of a board that cannot be solved are skipped so the stream stays in step
+		bool is_read;
+		if (request->is_valid) {
+			reserve_buffer(request, bit_bytes);
+			is_read = read_all(connection->in_fd, request->buffer, bit_bytes);
+			if (is_read) {
+				unpack_edge_bits(&request->board, width, height, request->buffer, EDGE_BOUNDARY | EDGE_BARRIER);
+			}
+		} else {
+			reserve_buffer(request, SKIP_CHUNK_SIZE);
+			is_read = true;
+			for (size_t remaining = bit_bytes; remaining > 0 && is_read;) {
+				size_t const n = (remaining < SKIP_CHUNK_SIZE) ? remaining : SKIP_CHUNK_SIZE;
+				is_read = read_all(connection->in_fd, request->buffer, n);
+				remaining -= n;
+			}
+		}
+		if (!is_read) {
+			request->connection = NULL;
+			release_request(server, request);
+			break;
+		}
+		submit_request(server, request);
+	}
+
+	pthread_mutex_lock(&server->lock);
+	release_connection(connection);
+	pthread_mutex_unlock(&server->lock);
+}
+
+static
+connection_t *open_connection(server_t *server, int in_fd, int out_fd, bool is_owner)
+{
+	connection_t *const connection = (connection_t *)calloc(1, sizeof(connection_t));
+	connection->server = server;
+	connection->in_fd = in_fd;
+	connection->out_fd = out_fd;
+	connection->is_owner = is_owner;
+	connection->ref_count = 1;
+	pthread_mutex_init(&connection->write_lock, NULL);
+	return connection;
+}
+
+static
+void *connection_main(void *arg)
+{
+	connection_t *const connection = (connection_t *)arg;
+	read_requests(connection->server, connection);
+	return NULL;
+}
+
+// accept connections until the process is killed, each gets a reader thread
+static
+bool serve_socket(server_t *server, char const *path)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "socket path \"%s\" is too long!\n", path);
+		return false;
+	}
+	strcpy(address.sun_path, path);
+
+	int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(path);
+	if (fd < 0 || bind(fd, (struct sockaddr const *)&address, sizeof(address)) != 0 || listen(fd, 64) != 0) {
+		fprintf(stderr, "failed to listen on \"%s\"!\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+	fprintf(stderr, "serving on %s with %u workers\n", path, server->worker_count);
+
+	for (;;) {
+		int const client_fd = accept(fd, NULL, NULL);
+		if (client_fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			fprintf(stderr, "failed to accept a connection!\n");
+			break;
+		}
+		connection_t *const connection = open_connection(server, client_fd, client_fd, true);
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, connection_main, connection) != 0) {
+			pthread_mutex_lock(&server->lock);
+			release_connection(connection);
+			pthread_mutex_unlock(&server->lock);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+	close(fd);
+	unlink(path);
+	return false;
+}
+
+// serve one connection on stdin/stdout, returns once every request has been answered
+static
+bool serve_stdio(server_t *server)
+{
+	read_requests(server, open_connection(server, STDIN_FILENO, STDOUT_FILENO, false));
+
+	pthread_mutex_lock(&server->lock);
+	while (server->free_count < server->window) {
+		pthread_cond_wait(&server->request_free, &server->lock);
+	}
+	pthread_mutex_unlock(&server->lock);
+	return true;
+}
+
+// keep solvers warm across requests, one per worker thread
+int run_serve(serve_options_t const *options)
+{
+	// a peer that goes away should fail its writes, not kill the server
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &action, NULL);
+
+	server_t server;
+	memset(&server, 0, sizeof(server_t));
+	server.options = *options;
+	server.worker_count = max(options->thread_count, 1);
+	server.window = 4*server.worker_count;
+	server.request_storage = (request_t *)calloc(server.window, sizeof(request_t));
+	for (uint i = 0; i < server.window; ++i) {
+		server.request_storage[i].next = server.free_requests;
+		server.free_requests = server.request_storage + i;
+	}
+	server.free_count = server.window;
+	pthread_mutex_init(&server.lock, NULL);
+	pthread_cond_init(&server.request_ready, NULL);
+	pthread_cond_init(&server.request_free, NULL);
+
+	server.workers = (worker_t *)calloc(server.worker_count, sizeof(worker_t));
+	for (uint i = 0; i < server.worker_count; ++i) {
+		worker_t *const worker = server.workers + i;
+		worker->server = &server;
+		worker->solver.bitboard = options->use_bitboard ? &worker->bitboard : NULL;
+		worker->solver.worklist = options->event_driven ? &worker->worklist : NULL;
+		pthread_create(&worker->thread, NULL, worker_main, worker);
+	}
+
+	bool const result = options->socket_path ? serve_socket(&server, options->socket_path) : serve_stdio(&server);
+
+	pthread_mutex_lock(&server.lock);
+	server.is_stopping = true;
+	pthread_cond_broadcast(&server.request_ready);
+	pthread_mutex_unlock(&server.lock);
+	for (uint i = 0; i < server.worker_count; ++i) {
+		worker_t *const worker = server.workers + i;
+		pthread_join(worker->thread, NULL);
+		if (worker->solver.capacity_width != 0) {
+			if (worker->solver.bitboard) {
+				free_bitboard(&worker->bitboard);
+			}
+			if (worker->solver.worklist) {
+				free_worklist(&worker->worklist);
+			}
+			free_solver(&worker->solver);
+		}
+	}
+	free(server.workers);
+
+	pthread_cond_destroy(&server.request_free);
+	pthread_cond_destroy(&server.request_ready);
+	pthread_mutex_destroy(&server.lock);
+	for (uint i = 0; i < server.window; ++i) {
+		free_board(&server.request_storage[i].board);
+		free(server.request_storage[i].buffer);
+	}
+	free(server.request_storage);
+	return result ? 0 : -1;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "board.h"
+
+// framed binary protocol over a Unix domain socket or stdin/stdout, all integers are little-endian
+//   request:  u32 size of the rest, u32 id, u32 width, u32 height, one bit per edge for walls
+//   response: u32 size of the rest, u32 id, u32 status, u32 step count, u32 width, u32 height,
+//             one bit per edge for the path
+// edge bits are laid out as in a corpus puzzle, requests may be pipelined and responses carry
+// the request id since they are sent as workers finish, not in request order
+// a request for a board that is too large gets SERVE_INVALID with a zero size board
+
+#define SERVE_HEADER_SIZE		4
+#define SERVE_REQUEST_SIZE		12		// fixed part after the size field
+#define SERVE_RESPONSE_SIZE		20
+#define SERVE_INVALID			0xffffffffU	// response status for a request that could not be read
+
+typedef struct
+{
+	char const *socket_path;	// NULL to serve stdin/stdout
+	uint thread_count;
+	bool use_bitboard;
+	bool event_driven;
+} serve_options_t;
+
+int run_serve(serve_options_t const *options);
@@ -0,0 +1,2517 @@
+#include "solver.h"
+#include "bitboard.h"
+#include "io.h"
+#include "stats.h"
+#include "trace.h"
+#include "kernels.h"
+#include "justify.h"
+#include "schedule.h"
+#include "sweep.h"
+#include "rounds.h"
+#include <stdlib.h>
+#include <memory.h>
+
+#define PARITY_CACHE_MIN	(1U << 10)
+#define PARITY_CACHE_MAX	(1U << 16)
+// fewer blocks than this are checked on the calling thread, waking the others costs more
+#define PARITY_SWEEP_MIN_BLOCKS	256
+
+void reset_to_boundary(board_t *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint *const edge_h = board->edge_h;
+	uint *const edge_v = board->edge_v;
+	for (uint i = 0; i < width*(height + 1); ++i) {
+		edge_h[i] = (edge_h[i] & EDGE_BOUNDARY) ? (EDGE_BOUNDARY | EDGE_BARRIER) : 0;
+	}
+	for (uint i = 0; i < (width + 1)*height; ++i) {
+		edge_v[i] = (edge_v[i] & EDGE_BOUNDARY) ? (EDGE_BOUNDARY | EDGE_BARRIER) : 0;
+	}
+}
+
+void copy_board(board_t *dst, board_t const *src)
+{
+	uint const width = src->width;
+	uint const height = src->height;
+
+	dst->width = width;
+	dst->height = height;
+	dst->edge_h = (uint *)malloc(width*(height + 1)*sizeof(uint));
+	dst->edge_v = (uint *)malloc((width + 1)*height*sizeof(uint));
+
+	memcpy(dst->edge_h, src->edge_h, width*(height + 1)*sizeof(uint));
+	memcpy(dst->edge_v, src->edge_v, (width + 1)*height*sizeof(uint));
+}
+
+void copy_board_edges(board_t *dst, board_t const *src)
+{
+	uint const width = src->width;
+	uint const height = src->height;
+
+	memcpy(dst->edge_h, src->edge_h, width*(height + 1)*sizeof(uint));
+	memcpy(dst->edge_v, src->edge_v, (width + 1)*height*sizeof(uint));
+}
+
+void swap_board(board_t *a, board_t *b)
+{
+	board_t tmp;
+	tmp.width = a->width;
+	tmp.height = a->height;
+	tmp.edge_h = a->edge_h;
+	tmp.edge_v = a->edge_v;
+
+	a->width = b->width;
+	a->height = b->height;
+	a->edge_h = b->edge_h;
+	a->edge_v = b->edge_v;
+
+	b->width = tmp.width;
+	b->height = tmp.height;
+	b->edge_h = tmp.edge_h;
+	b->edge_v = tmp.edge_v;
+}
+
+void free_board(board_t *board)
+{
+	free(board->edge_h);
+	free(board->edge_v);
+	memset(board, 0, sizeof(board_t));
+}
+
+void copy_edges_to_solver(solver_t const *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+
+	memcpy(solver->edge_h_old, board->edge_h, width*(height + 1)*sizeof(uint));
+	memcpy(solver->edge_v_old, board->edge_v, (width + 1)*height*sizeof(uint));
+}
+
+// rules set edges through here, with k in edge id order, so the bit-planes see every write
+void decide_edge(solver_t const *solver, board_t const *board, uint k, uint bits)
+{
+	uint const edge_count_h = board->width*(board->height + 1);
+	uint *const e = (k < edge_count_h) ? (board->edge_h + k) : (board->edge_v + k - edge_count_h);
+	if ((*e & (EDGE_PATH | EDGE_BARRIER)) == 0) {
+		if (solver->stats) {
+			++solver->stats->decided_count;
+		}
+		if (solver->schedule) {
+			++solver->schedule->decided_count;
+		}
+	}
+	if (solver->trace && (*e | bits) != *e) {
+		trace_edge(solver->trace, k, *e);
+	}
+	*e |= bits;
+	if (solver->bitboard) {
+		set_bitboard_edge(solver->bitboard, board, k, bits);
+	}
+}
+
+// false if any buffer could not be allocated, free_solver still cleans up
+bool init_solver(solver_t *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+
+	memset(solver, 0, sizeof(solver_t));
+	solver->capacity_width = width;
+	solver->capacity_height = height;
+	solver->edge_h_old = (uint *)malloc(width*(height + 1)*sizeof(uint));
+	solver->edge_v_old = (uint *)malloc((width + 1)*height*sizeof(uint));
+	solver->tmp1 = (uint *)malloc((width + 1)*(height + 1)*sizeof(uint));
+	solver->tmp2 = (uint *)malloc((width + 1)*(height + 1)*sizeof(uint));
+	solver->barrier_sum_h = (uint *)malloc((width + 1)*(height + 2)*sizeof(uint));
+	solver->barrier_sum_v = (uint *)malloc((width + 2)*(height + 1)*sizeof(uint));
+	solver->perimeter_sum_h = (uint *)malloc(4*(width + 1)*(height + 1)*sizeof(uint));
+	solver->perimeter_sum_v = (uint *)malloc(4*(width + 1)*(height + 1)*sizeof(uint));
+	solver->island_counts = (parity_counts_t *)malloc((width*height + 1)*sizeof(parity_counts_t));
+	solver->state_hash_h = (uint64_t *)malloc((width + 1)*(height + 2)*sizeof(uint64_t));
+	solver->state_hash_v = (uint64_t *)malloc((width + 2)*(height + 1)*sizeof(uint64_t));
+
+	// a few entries per block position, within reason for large boards
+	uint64_t const block_count = ((uint64_t)width*(width + 1)/2)*((uint64_t)height*(height + 1)/2);
+	uint capacity = PARITY_CACHE_MIN;
+	while (capacity < PARITY_CACHE_MAX && capacity < 4*block_count) {
+		capacity *= 2;
+	}
+	solver->parity_cache = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+	solver->parity_cache_mask = capacity - 1;
+	solver->kernels = default_cell_kernels();
+	return solver->edge_h_old && solver->edge_v_old && solver->tmp1 && solver->tmp2
+		&& solver->barrier_sum_h && solver->barrier_sum_v && solver->perimeter_sum_h && solver->perimeter_sum_v
+		&& solver->island_counts && solver->state_hash_h && solver->state_hash_v && solver->parity_cache;
+}
+
+void free_solver(solver_t *solver)
+{
+	free(solver->edge_h_old);
+	free(solver->edge_v_old);
+	free(solver->tmp1);
+	free(solver->tmp2);
+	free(solver->barrier_sum_h);
+	free(solver->barrier_sum_v);
+	free(solver->perimeter_sum_h);
+	free(solver->perimeter_sum_v);
+	free(solver->island_counts);
+	free(solver->state_hash_h);
+	free(solver->state_hash_v);
+	free(solver->parity_cache);
+	memset(solver, 0, sizeof(solver_t));
+}
+
+// grow the solver buffers (and any bitboard or worklist) only when a board does not fit
+void reserve_solver(solver_t *solver, board_t const *board)
+{
+	if (board->width <= solver->capacity_width && board->height <= solver->capacity_height) {
+		return;
+	}
+
+	board_t capacity;
+	memset(&capacity, 0, sizeof(board_t));
+	capacity.width = max(board->width, solver->capacity_width);
+	capacity.height = max(board->height, solver->capacity_height);
+
+	bitboard_t *const bitboard = solver->bitboard;
+	worklist_t *const worklist = solver->worklist;
+	stats_t *const stats = solver->stats;
+	trace_t *const trace = solver->trace;
+	justify_t *const justify = solver->justify;
+	schedule_t *const schedule = solver->schedule;
+	struct parity_sweep_t *const sweep = solver->sweep;
+	struct round_pool_t *const rounds = solver->rounds;
+	struct cell_kernels_t const *const kernels = solver->kernels;
+	bool const verbose = solver->verbose;
+	free_solver(solver);
+	init_solver(solver, &capacity);
+	solver->verbose = verbose;
+	if (kernels) {
+		solver->kernels = kernels;
+	}
+	solver->stats = stats;
+	solver->trace = trace;
+	solver->schedule = schedule;
+	solver->sweep = sweep;
+	solver->rounds = rounds;
+	if (bitboard) {
+		free_bitboard(bitboard);
+		init_bitboard(bitboard, &capacity);
+		solver->bitboard = bitboard;
+	}
+	if (worklist) {
+		free_worklist(worklist);
+		init_worklist(worklist, &capacity);
+		solver->worklist = worklist;
+	}
+	if (justify) {
+		free_justify(justify);
+		init_justify(justify, &capacity);
+		solver->justify = justify;
+	}
+}
+
+// false if any buffer could not be allocated, free_worklist still cleans up
+bool init_worklist(worklist_t *worklist, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+
+	memset(worklist, 0, sizeof(worklist_t));
+	worklist->cells = (uint *)malloc(width*height*sizeof(uint));
+	worklist->is_queued = (uint *)malloc(width*height*sizeof(uint));
+	worklist->stamp_h = (uint *)malloc(width*(height + 1)*sizeof(uint));
+	worklist->stamp_v = (uint *)malloc((width + 1)*height*sizeof(uint));
+	worklist->size_clean = (uint *)malloc((width + 1)*(height + 1)*sizeof(uint));
+	worklist->dirty_sum_h = (uint *)malloc((width + 1)*(height + 2)*sizeof(uint));
+	worklist->dirty_sum_v = (uint *)malloc((width + 2)*(height + 1)*sizeof(uint));
+	worklist->path_parent = (uint *)malloc(width*height*sizeof(uint));
+	worklist->path_size = (uint *)malloc(width*height*sizeof(uint));
+	worklist->path_degree = (uint *)malloc(width*height*sizeof(uint));
+	worklist->path_ends = (uint *)malloc(2*width*height*sizeof(uint));
+	worklist->loop_cells = (uint *)malloc(width*height*sizeof(uint));
+	worklist->is_loop_queued = (uint *)malloc(width*height*sizeof(uint));
+	worklist->loop_stamp = (uint *)malloc(width*height*sizeof(uint));
+	worklist->corner_parent = (uint *)malloc(((width + 1)*(height + 1) + 1)*sizeof(uint));
+	worklist->corner_size = (uint *)malloc(((width + 1)*(height + 1) + 1)*sizeof(uint));
+	worklist->corner_next = (uint *)malloc(((width + 1)*(height + 1) + 1)*sizeof(uint));
+	worklist->partition_edges = (uint *)malloc(4*((width + 1)*(height + 1) + 1)*sizeof(uint));
+	return worklist->cells && worklist->is_queued && worklist->stamp_h && worklist->stamp_v
+		&& worklist->size_clean && worklist->dirty_sum_h && worklist->dirty_sum_v
+		&& worklist->path_parent && worklist->path_size && worklist->path_degree && worklist->path_ends
+		&& worklist->loop_cells && worklist->is_loop_queued && worklist->loop_stamp
+		&& worklist->corner_parent && worklist->corner_size && worklist->corner_next && worklist->partition_edges;
+}
+
+void free_worklist(worklist_t *worklist)
+{
+	free(worklist->cells);
+	free(worklist->is_queued);
+	free(worklist->stamp_h);
+	free(worklist->stamp_v);
+	free(worklist->size_clean);
+	free(worklist->dirty_sum_h);
+	free(worklist->dirty_sum_v);
+	free(worklist->path_parent);
+	free(worklist->path_size);
+	free(worklist->path_degree);
+	free(worklist->path_ends);
+	free(worklist->loop_cells);
+	free(worklist->is_loop_queued);
+	free(worklist->loop_stamp);
+	free(worklist->corner_parent);
+	free(worklist->corner_size);
+	free(worklist->corner_next);
+	free(worklist->partition_edges);
+	memset(worklist, 0, sizeof(worklist_t));
+}
+
+static
+bool check_single_cell(solver_t const *solver, board_t const *board, uint x, uint y)
+{
+	uint const width = board->width;
+	uint const edge_count_h = width*(board->height + 1);
+
+	// check the number of useable edges
+	uint ids[4];
+	ids[0] = y*width + x;
+	ids[1] = ids[0] + width;
+	ids[2] = edge_count_h + y*(width + 1) + x;
+	ids[3] = ids[2] + 1;
+
+	uint available_mask = 0;
+	uint path_mask = 0;
+	for (uint i = 0; i < 4; ++i) {
+		uint const e = (i < 2) ? board->edge_h[ids[i]] : board->edge_v[ids[i] - edge_count_h];
+		if ((e & EDGE_BARRIER) == 0) {
+			available_mask |= (1U << i);
+		}
+		if (e & EDGE_PATH) {
+			path_mask |= (1U << i);
+		}
+	}
+
+	uint const available_count = __builtin_popcount(available_mask);
+	uint const path_count = __builtin_popcount(path_mask);
+
+	if (available_count == 2 && path_count < 2) {
+		for (uint i = 0; i < 4; ++i) {
+			decide_edge(solver, board, ids[i], (available_mask & (1U << i)) ? EDGE_PATH : EDGE_BARRIER);
+		}
+		return true;
+	} else if (path_count == 2 && available_count > 2) {
+		for (uint i = 0; i < 4; ++i) {
+			if ((path_mask & (1U << i)) == 0) {
+				decide_edge(solver, board, ids[i], EDGE_BARRIER);
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+// ids of the north, south, west and east edges of a cell and their bits
+static
+void cell_edges(board_t const *board, uint x, uint y, uint *ids, uint *bits)
+{
+	uint const width = board->width;
+	uint const edge_count_h = width*(board->height + 1);
+	ids[0] = y*width + x;
+	ids[1] = ids[0] + width;
+	ids[2] = edge_count_h + y*(width + 1) + x;
+	ids[3] = ids[2] + 1;
+	bits[0] = board->edge_h[ids[0]];
+	bits[1] = board->edge_h[ids[1]];
+	bits[2] = board->edge_v[ids[2] - edge_count_h];
+	bits[3] = board->edge_v[ids[3] - edge_count_h];
+}
+
+// a cell that set paths did so because of its two barriers, one that set barriers because of its two paths
+static
+void justify_cell(justify_t *justify, board_t const *board, uint const *ids, uint const *before)
+{
+	uint const edge_count_h = board->width*(board->height + 1);
+	uint after[4];
+	uint made = 0;
+	for (uint i = 0; i < 4; ++i) {
+		uint const k = ids[i];
+		after[i] = (k < edge_count_h) ? board->edge_h[k] : board->edge_v[k - edge_count_h];
+		made |= after[i] & ~before[i];
+	}
+	uint const premise_bit = (made & EDGE_PATH) ? EDGE_BARRIER : EDGE_PATH;
+	for (uint i = 0; i < 4; ++i) {
+		if (before[i] & premise_bit) {
+			justify_premise(justify, ids[i]);
+		}
+	}
+	for (uint i = 0; i < 4; ++i) {
+		if (after[i] != before[i]) {
+			justify_decided(justify, ids[i]);
+		}
+	}
+	justify_end(justify);
+}
+
+bool check_single_cells(solver_t const *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint *const cells = solver->tmp1;
+
+	memset(cells, 0, width*height*sizeof(uint));
+
+	// the kernel finds the cells that would fire on the row as it stands, a cell that fires
+	// can change the west edge of the next one so that is checked too, giving the same result
+	// as checking every cell in order
+	cell_kernels_t const *const kernels = solver->kernels;
+	justify_t *const justify = solver->justify;
+	bool changed = false;
+	for (uint y = 0; y < height; ++y)
+	for (uint x0 = 0; x0 < width; x0 += 64) {
+		uint const count = min(width - x0, 64);
+		uint64_t candidates = kernels->single_cells(edge_h + y*width + x0, edge_h + (y + 1)*width + x0, edge_v + y*(width + 1) + x0, count);
+		while (candidates != 0) {
+			uint const j = (uint)__builtin_ctzll(candidates);
+			candidates &= candidates - 1;
+			uint ids[4];
+			uint before[4];
+			if (justify) {
+				cell_edges(board, x0 + j, y, ids, before);
+			}
+			if (check_single_cell(solver, board, x0 + j, y)) {
+				if (justify) {
+					justify_cell(justify, board, ids, before);
+				}
+				cells[y*width + x0 + j] = 1;
+				changed = true;
+				if (j + 1 < count) {
+					candidates |= 1ULL << (j + 1);
+				}
+			}
+		}
+	}
+
+	if (changed && solver->verbose) {
+		fputs("\nsingle cells:\n", stdout);
+		print_board(solver, board, EDGE_ALL | EDGE_HIGHLIGHT | EDGE_NEW);
+	}
+
+	return changed;
+}
+
+static inline
+void queue_cell(worklist_t *worklist, uint cell_count, uint i)
+{
+	if (!worklist->is_queued[i]) {
+		worklist->is_queued[i] = 1;
+		worklist->cells[(worklist->head + worklist->count++) % cell_count] = i;
+	}
+}
+
+// only checks cells that had an adjacent edge change since they were last checked
+bool check_single_cells_queued(solver_t const *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint *const cells = solver->tmp1;
+	worklist_t *const worklist = solver->worklist;
+
+	memset(cells, 0, width*height*sizeof(uint));
+
+	bool changed = false;
+	for (; worklist->count > 0; --worklist->count) {
+		uint const i = worklist->cells[worklist->head];
+		worklist->head = (worklist->head + 1) % (width*height);
+		worklist->is_queued[i] = 0;
+		if (check_single_cell(solver, board, i % width, i/width)) {
+			cells[i] = 1;
+			changed = true;
+		}
+	}
+
+	if (changed && solver->verbose) {
+		fputs("\nsingle cells:\n", stdout);
+		print_board(solver, board, EDGE_ALL | EDGE_HIGHLIGHT | EDGE_NEW);
+	}
+
+	return changed;
+}
+
+static inline
+void queue_loop_cell(worklist_t *worklist, uint i)
+{
+	if (!worklist->is_loop_queued[i]) {
+		worklist->is_loop_queued[i] = 1;
+		worklist->loop_cells[worklist->loop_cell_count++] = i;
+	}
+}
+
+static
+void clear_loop_cells(worklist_t *worklist)
+{
+	for (uint i = 0; i < worklist->loop_cell_count; ++i) {
+		worklist->is_loop_queued[worklist->loop_cells[i]] = 0;
+	}
+	worklist->loop_cell_count = 0;
+}
+
+static
+void add_path_cell(worklist_t *worklist, uint i)
+{
+	if (worklist->path_parent[i] == NOT_ON_PATH) {
+		worklist->path_parent[i] = i;
+		worklist->path_size[i] = 1;
+		worklist->path_ends[2*i] = NOT_ON_PATH;
+		worklist->path_ends[2*i + 1] = NOT_ON_PATH;
+		++worklist->path_count;
+	}
+	++worklist->path_degree[i];
+}
+
+static
+void add_path_end(worklist_t *worklist, uint root, uint i)
+{
+	uint *const ends = worklist->path_ends + 2*root;
+	if (ends[0] == NOT_ON_PATH) {
+		ends[0] = i;
+	} else if (ends[1] == NOT_ON_PATH) {
+		ends[1] = i;
+	} else {
+		worklist->paths_are_simple = false;
+	}
+}
+
+// a cell with one path edge is an end of its segment, with two it no longer is, with more the segment branches
+static
+void update_path_end(worklist_t *worklist, uint root, uint i)
+{
+	uint *const ends = worklist->path_ends + 2*root;
+	uint const degree = worklist->path_degree[i];
+	if (degree == 1) {
+		add_path_end(worklist, root, i);
+	} else if (degree == 2) {
+		if (ends[0] == i) {
+			ends[0] = NOT_ON_PATH;
+		} else if (ends[1] == i) {
+			ends[1] = NOT_ON_PATH;
+		}
+	} else {
+		worklist->paths_are_simple = false;
+	}
+}
+
+// called as each path edge is set, cells a and b are either side or b is NOT_ON_PATH for an exit
+void add_path_edge(worklist_t *worklist, uint a, uint b)
+{
+	uint *const parent = worklist->path_parent;
+	add_path_cell(worklist, a);
+	if (b == NOT_ON_PATH) {
+		if (worklist->exit_count < 2) {
+			worklist->exit_cells[worklist->exit_count] = a;
+		}
+		++worklist->exit_count;
+		update_path_end(worklist, find_root(parent, a), a);
+		return;
+	}
+	add_path_cell(worklist, b);
+
+	uint ra = find_root(parent, a);
+	uint rb = find_root(parent, b);
+	if (ra == rb) {
+		worklist->paths_are_simple = false;
+		return;
+	}
+	update_path_end(worklist, ra, a);
+	update_path_end(worklist, rb, b);
+	if (worklist->path_size[ra] < worklist->path_size[rb]) {
+		uint const tmp = ra;
+		ra = rb;
+		rb = tmp;
+	}
+	parent[rb] = ra;
+	worklist->path_size[ra] += worklist->path_size[rb];
+	--worklist->path_count;
+	for (uint i = 0; i < 2; ++i) {
+		if (worklist->path_ends[2*rb + i] != NOT_ON_PATH) {
+			add_path_end(worklist, ra, worklist->path_ends[2*rb + i]);
+		}
+	}
+}
+
+static
+void queue_partition_edge(worklist_t *worklist, uint k)
+{
+	worklist->partition_edges[worklist->partition_edge_count++] = k;
+}
+
+// queue interior edges at a newly boundary-connected corner whose other corner is also connected
+static
+void check_partition_corner(worklist_t *worklist, board_t const *board, uint c, uint boundary_root)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const s = width + 1;
+	uint const edge_h_count = width*(height + 1);
+	uint *const parent = worklist->corner_parent;
+	uint const x = c % s;
+	uint const y = c/s;
+
+	if (y > 0 && y < height) {
+		if (x > 0 && find_root(parent, c - 1) == boundary_root) {
+			queue_partition_edge(worklist, y*width + x - 1);
+		}
+		if (x < width && find_root(parent, c + 1) == boundary_root) {
+			queue_partition_edge(worklist, y*width + x);
+		}
+	}
+	if (x > 0 && x < width) {
+		if (y > 0 && find_root(parent, c - s) == boundary_root) {
+			queue_partition_edge(worklist, edge_h_count + (y - 1)*s + x);
+		}
+		if (y < height && find_root(parent, c + s) == boundary_root) {
+			queue_partition_edge(worklist, edge_h_count + y*s + x);
+		}
+	}
+}
+
+// called as each barrier is set between corners a and b
+void add_barrier_edge(worklist_t *worklist, board_t const *board, uint a, uint b)
+{
+	uint *const parent = worklist->corner_parent;
+	uint *const next = worklist->corner_next;
+	uint const boundary = (board->width + 1)*(board->height + 1);
+
+	uint ra = find_root(parent, a);
+	uint rb = find_root(parent, b);
+	if (ra == rb) {
+		return;
+	}
+	uint const boundary_root = find_root(parent, boundary);
+	uint const joined = (ra == boundary_root) ? rb : (rb == boundary_root) ? ra : ~0U;
+
+	if (worklist->corner_size[ra] < worklist->corner_size[rb]) {
+		uint const tmp = ra;
+		ra = rb;
+		rb = tmp;
+	}
+	parent[rb] = ra;
+	worklist->corner_size[ra] += worklist->corner_size[rb];
+
+	// visit the corners that just became connected to the boundary before merging the lists
+	if (joined != ~0U) {
+		uint c = joined;
+		do {
+			if (c != boundary) {
+				check_partition_corner(worklist, board, c, ra);
+			}
+			c = next[c];
+		} while (c != joined);
+	}
+	uint const tmp = next[ra];
+	next[ra] = next[rb];
+	next[rb] = tmp;
+}
+
+void reset_worklist(solver_t const *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	worklist_t *const worklist = solver->worklist;
+
+	copy_edges_to_solver(solver, board);
+	worklist->head = 0;
+	worklist->count = width*height;
+	for (uint i = 0; i < width*height; ++i) {
+		worklist->cells[i] = i;
+		worklist->is_queued[i] = 1;
+	}
+	worklist->generation = 1;
+	for (uint i = 0; i < width*(height + 1); ++i) {
+		worklist->stamp_h[i] = 1;
+	}
+	for (uint i = 0; i < (width + 1)*height; ++i) {
+		worklist->stamp_v[i] = 1;
+	}
+	memset(worklist->size_clean, 0, (width + 1)*(height + 1)*sizeof(uint));
+	worklist->dirty_since = 0;
+
+	// connect the boundary corners, then build path segments and barrier sets from existing edges
+	uint const corner_count = (width + 1)*(height + 1);
+	for (uint i = 0; i <= corner_count; ++i) {
+		worklist->corner_parent[i] = i;
+		worklist->corner_size[i] = 1;
+		worklist->corner_next[i] = i;
+	}
+	worklist->partition_edge_count = 0;
+	for (uint x = 1; x < width; ++x) {
+		add_barrier_edge(worklist, board, corner_count, x);
+		add_barrier_edge(worklist, board, corner_count, height*(width + 1) + x);
+	}
+	for (uint y = 1; y < height; ++y) {
+		add_barrier_edge(worklist, board, corner_count, y*(width + 1));
+		add_barrier_edge(worklist, board, corner_count, y*(width + 1) + width);
+	}
+	memset(worklist->path_parent, 0xff, width*height*sizeof(uint));
+	memset(worklist->path_degree, 0, width*height*sizeof(uint));
+	worklist->path_count = 0;
+	worklist->exit_count = 0;
+	worklist->paths_are_simple = true;
+	worklist->loops_scan_all = true;
+	memset(worklist->is_loop_queued, 0, width*height*sizeof(uint));
+	memset(worklist->loop_stamp, 0, width*height*sizeof(uint));
+	worklist->loop_cell_count = 0;
+	worklist->loop_generation = 0;
+	for (uint y = 0; y <= height; ++y)
+	for (uint x = 0; x < width; ++x) {
+		uint const k = y*width + x;
+		if (board->edge_h[k] & EDGE_PATH) {
+			add_path_edge(worklist, (y > 0) ? (k - width) : k, (y > 0 && y < height) ? k : NOT_ON_PATH);
+		}
+		if (board->edge_h[k] & EDGE_BARRIER) {
+			add_barrier_edge(worklist, board, y*(width + 1) + x, y*(width + 1) + x + 1);
+		}
+	}
+	for (uint y = 0; y < height; ++y)
+	for (uint x = 0; x <= width; ++x) {
+		if (board->edge_v[y*(width + 1) + x] & EDGE_PATH) {
+			add_path_edge(worklist, y*width + ((x > 0) ? (x - 1) : x), (x > 0 && x < width) ? (y*width + x) : NOT_ON_PATH);
+		}
+		if (board->edge_v[y*(width + 1) + x] & EDGE_BARRIER) {
+			add_barrier_edge(worklist, board, y*(width + 1) + x, (y + 1)*(width + 1) + x);
+		}
+	}
+}
+
+// diff against the edges from the last call, queue work for anything that changed
+void sync_worklist(solver_t const *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const cell_count = width*height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint *const edge_h_old = solver->edge_h_old;
+	uint *const edge_v_old = solver->edge_v_old;
+	worklist_t *const worklist = solver->worklist;
+
+	uint const generation = ++worklist->generation;
+	worklist->dirty_since = 0;	// the sums built so far miss the changes collected below
+	for (uint y = 0; y <= height; ++y)
+	for (uint x = 0; x < width; ++x) {
+		uint const k = y*width + x;
+		if (edge_h[k] != edge_h_old[k]) {
+			if (edge_h[k] & ~edge_h_old[k] & EDGE_PATH) {
+				add_path_edge(worklist, (y > 0) ? (k - width) : k, (y > 0 && y < height) ? k : NOT_ON_PATH);
+			}
+			if (edge_h[k] & ~edge_h_old[k] & EDGE_BARRIER) {
+				add_barrier_edge(worklist, board, y*(width + 1) + x, y*(width + 1) + x + 1);
+			}
+			edge_h_old[k] = edge_h[k];
+			worklist->stamp_h[k] = generation;
+			if (y > 0) {
+				queue_cell(worklist, cell_count, k - width);
+				queue_loop_cell(worklist, k - width);
+			}
+			if (y < height) {
+				queue_cell(worklist, cell_count, k);
+				queue_loop_cell(worklist, k);
+			}
+		}
+	}
+	for (uint y = 0; y < height; ++y)
+	for (uint x = 0; x <= width; ++x) {
+		uint const k = y*(width + 1) + x;
+		if (edge_v[k] != edge_v_old[k]) {
+			if (edge_v[k] & ~edge_v_old[k] & EDGE_PATH) {
+				add_path_edge(worklist, y*width + ((x > 0) ? (x - 1) : x), (x > 0 && x < width) ? (y*width + x) : NOT_ON_PATH);
+			}
+			if (edge_v[k] & ~edge_v_old[k] & EDGE_BARRIER) {
+				add_barrier_edge(worklist, board, k, k + width + 1);
+			}
+			edge_v_old[k] = edge_v[k];
+			worklist->stamp_v[k] = generation;
+			if (x > 0) {
+				queue_cell(worklist, cell_count, y*width + x - 1);
+				queue_loop_cell(worklist, y*width + x - 1);
+			}
+			if (x < width) {
+				queue_cell(worklist, cell_count, y*width + x);
+				queue_loop_cell(worklist, y*width + x);
+			}
+		}
+	}
+}
+
+void build_dirty_sums(solver_t const *solver, board_t const *board, uint since)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	worklist_t *const worklist = solver->worklist;
+	uint const *const stamp_h = worklist->stamp_h;
+	uint const *const stamp_v = worklist->stamp_v;
+	uint *const dirty_sum_h = worklist->dirty_sum_h;
+	uint *const dirty_sum_v = worklist->dirty_sum_v;
+
+	if (worklist->dirty_since == since) {
+		return;
+	}
+	worklist->dirty_since = since;
+
+	uint const sh = width + 1;
+	memset(dirty_sum_h, 0, sh*sizeof(uint));
+	for (uint y = 0; y <= height; ++y) {
+		uint row = 0;
+		dirty_sum_h[(y + 1)*sh] = 0;
+		for (uint x = 0; x < width; ++x) {
+			row += (stamp_h[y*width + x] > since) ? 1 : 0;
+			dirty_sum_h[(y + 1)*sh + x + 1] = dirty_sum_h[y*sh + x + 1] + row;
+		}
+	}
+	uint const sv = width + 2;
+	memset(dirty_sum_v, 0, sv*sizeof(uint));
+	for (uint y = 0; y < height; ++y) {
+		uint row = 0;
+		dirty_sum_v[(y + 1)*sv] = 0;
+		for (uint x = 0; x <= width; ++x) {
+			row += (stamp_v[y*(width + 1) + x] > since) ? 1 : 0;
+			dirty_sum_v[(y + 1)*sv + x + 1] = dirty_sum_v[y*sv + x + 1] + row;
+		}
+	}
+}
+
+// checks the interior and perimeter edges of a block against the current dirty sums
+bool parity_block_is_dirty(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1)
+{
+	uint const width = board->width;
+	uint const *const dirty_sum_h = solver->worklist->dirty_sum_h;
+	uint const *const dirty_sum_v = solver->worklist->dirty_sum_v;
+
+	// horizontal edge rows y0 to y1, vertical edge columns x0 to x1
+	uint const sh = width + 1;
+	uint const sv = width + 2;
+	uint const dirty_h = dirty_sum_h[(y1 + 1)*sh + x1] - dirty_sum_h[y0*sh + x1] - dirty_sum_h[(y1 + 1)*sh + x0] + dirty_sum_h[y0*sh + x0];
+	uint const dirty_v = dirty_sum_v[y1*sv + x1 + 1] - dirty_sum_v[y0*sv + x1 + 1] - dirty_sum_v[y1*sv + x0] + dirty_sum_v[y0*sv + x0];
+	return dirty_h != 0 || dirty_v != 0;
+}
+
+static inline
+uint parity(uint x, uint y)
+{
+	return (x ^ y) & 1;
+}
+
+void build_parity_sums(solver_t const *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint *const barrier_sum_h = solver->barrier_sum_h;
+	uint *const barrier_sum_v = solver->barrier_sum_v;
+	uint *const perimeter_sum_h = solver->perimeter_sum_h;
+	uint *const perimeter_sum_v = solver->perimeter_sum_v;
+
+	// 2D sums of barriers, entry (x, y) covers all edges above and to the left
+	uint const sh = width + 1;
+	memset(barrier_sum_h, 0, sh*sizeof(uint));
+	for (uint y = 0; y <= height; ++y) {
+		uint row = 0;
+		barrier_sum_h[(y + 1)*sh] = 0;
+		for (uint x = 0; x < width; ++x) {
+			row += (edge_h[y*width + x] & EDGE_BARRIER) ? 1 : 0;
+			barrier_sum_h[(y + 1)*sh + x + 1] = barrier_sum_h[y*sh + x + 1] + row;
+		}
+	}
+	uint const sv = width + 2;
+	memset(barrier_sum_v, 0, sv*sizeof(uint));
+	for (uint y = 0; y < height; ++y) {
+		uint row = 0;
+		barrier_sum_v[(y + 1)*sv] = 0;
+		for (uint x = 0; x <= width; ++x) {
+			row += (edge_v[y*(width + 1) + x] & EDGE_BARRIER) ? 1 : 0;
+			barrier_sum_v[(y + 1)*sv + x + 1] = barrier_sum_v[y*sv + x + 1] + row;
+		}
+	}
+
+	// running sums along each edge row or column of { available, path } by edge parity
+	for (uint y = 0; y <= height; ++y) {
+		uint *sum = perimeter_sum_h + 4*y*(width + 1);
+		memset(sum, 0, 4*sizeof(uint));
+		for (uint x = 0; x < width; ++x, sum += 4) {
+			uint const e = edge_h[y*width + x];
+			uint const p = parity(x, y);
+			memcpy(sum + 4, sum, 4*sizeof(uint));
+			sum[4 + p] += (e & EDGE_BARRIER) ? 0 : 1;
+			sum[6 + p] += (e & EDGE_PATH) ? 1 : 0;
+		}
+	}
+	for (uint x = 0; x <= width; ++x) {
+		uint *sum = perimeter_sum_v + 4*x*(height + 1);
+		memset(sum, 0, 4*sizeof(uint));
+		for (uint y = 0; y < height; ++y, sum += 4) {
+			uint const e = edge_v[y*(width + 1) + x];
+			uint const p = parity(x, y);
+			memcpy(sum + 4, sum, 4*sizeof(uint));
+			sum[4 + p] += (e & EDGE_BARRIER) ? 0 : 1;
+			sum[6 + p] += (e & EDGE_PATH) ? 1 : 0;
+		}
+	}
+}
+
+static inline
+uint64_t mix_hash(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+// random value per edge and { barrier, path } state, also keyed by the board size since a
+// block covering the whole board is checked differently
+static inline
+uint64_t edge_state_hash(uint64_t size_hash, uint k, uint e)
+{
+	return mix_hash(size_hash + ((uint64_t)k << 2 | ((e >> 1) & 3)));
+}
+
+// xor is its own inverse, so these work like the barrier sums: any block's edges hash in O(1)
+void build_state_hashes(solver_t const *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint64_t *const state_hash_h = solver->state_hash_h;
+	uint64_t *const state_hash_v = solver->state_hash_v;
+	uint64_t const size_hash = mix_hash((uint64_t)width << 32 | height);
+
+	uint const sh = width + 1;
+	memset(state_hash_h, 0, sh*sizeof(uint64_t));
+	for (uint y = 0; y <= height; ++y) {
+		uint64_t row = 0;
+		state_hash_h[(y + 1)*sh] = 0;
+		for (uint x = 0; x < width; ++x) {
+			uint const k = y*width + x;
+			row ^= edge_state_hash(size_hash, k, edge_h[k]);
+			state_hash_h[(y + 1)*sh + x + 1] = state_hash_h[y*sh + x + 1] ^ row;
+		}
+	}
+	uint const sv = width + 2;
+	uint const edge_count_h = width*(height + 1);
+	memset(state_hash_v, 0, sv*sizeof(uint64_t));
+	for (uint y = 0; y < height; ++y) {
+		uint64_t row = 0;
+		state_hash_v[(y + 1)*sv] = 0;
+		for (uint x = 0; x <= width; ++x) {
+			uint const k = y*(width + 1) + x;
+			row ^= edge_state_hash(size_hash, edge_count_h + k, edge_v[k]);
+			state_hash_v[(y + 1)*sv + x + 1] = state_hash_v[y*sv + x + 1] ^ row;
+		}
+	}
+}
+
+// hash of the interior and perimeter edges of a block, never 0 so 0 can mark empty cache slots
+uint64_t parity_block_hash(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1)
+{
+	uint const width = board->width;
+	uint64_t const *const state_hash_h = solver->state_hash_h;
+	uint64_t const *const state_hash_v = solver->state_hash_v;
+
+	// horizontal edge rows y0 to y1, vertical edge columns x0 to x1
+	uint const sh = width + 1;
+	uint const sv = width + 2;
+	uint64_t const hash_h = state_hash_h[(y1 + 1)*sh + x1] ^ state_hash_h[y0*sh + x1] ^ state_hash_h[(y1 + 1)*sh + x0] ^ state_hash_h[y0*sh + x0];
+	uint64_t const hash_v = state_hash_v[y1*sv + x1 + 1] ^ state_hash_v[y0*sv + x1 + 1] ^ state_hash_v[y1*sv + x0] ^ state_hash_v[y0*sv + x0];
+	return (hash_h ^ hash_v) | 1;
+}
+
+// two way buckets, the hash picks which way a new entry replaces
+bool parity_cache_contains(solver_t const *solver, uint64_t hash)
+{
+	uint64_t const *const bucket = solver->parity_cache + ((uint)(hash >> 32) & solver->parity_cache_mask & ~1U);
+	return bucket[0] == hash || bucket[1] == hash;
+}
+
+void parity_cache_insert(solver_t const *solver, uint64_t hash)
+{
+	uint64_t *const bucket = solver->parity_cache + ((uint)(hash >> 32) & solver->parity_cache_mask & ~1U);
+	if (bucket[0] == 0) {
+		bucket[0] = hash;
+	} else if (bucket[1] == 0) {
+		bucket[1] = hash;
+	} else {
+		bucket[(hash >> 1) & 1] = hash;
+	}
+}
+
+static inline
+void add_perimeter_sum(parity_counts_t *counts, uint const *a, uint const *b, uint flip)
+{
+	for (uint p = 0; p < 2; ++p) {
+		counts->available_count[p ^ flip] += b[p] - a[p];
+		counts->path_count[p ^ flip] += b[2 + p] - a[2 + p];
+	}
+}
+
+void parity_count_block_perimeter(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1, parity_counts_t *counts)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const perimeter_sum_h = solver->perimeter_sum_h;
+	uint const *const perimeter_sum_v = solver->perimeter_sum_v;
+
+	// edges on the far side of the block are adjacent to cells of the opposite parity
+	memset(counts->available_count, 0, sizeof(counts->available_count));
+	memset(counts->path_count, 0, sizeof(counts->path_count));
+	add_perimeter_sum(counts, perimeter_sum_h + 4*(y0*(width + 1) + x0), perimeter_sum_h + 4*(y0*(width + 1) + x1), 0);
+	add_perimeter_sum(counts, perimeter_sum_h + 4*(y1*(width + 1) + x0), perimeter_sum_h + 4*(y1*(width + 1) + x1), 1);
+	add_perimeter_sum(counts, perimeter_sum_v + 4*(x0*(height + 1) + y0), perimeter_sum_v + 4*(x0*(height + 1) + y1), 0);
+	add_perimeter_sum(counts, perimeter_sum_v + 4*(x1*(height + 1) + y0), perimeter_sum_v + 4*(x1*(height + 1) + y1), 1);
+}
+
+bool parity_block_has_interior_barriers(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1)
+{
+	uint const width = board->width;
+	uint const *const barrier_sum_h = solver->barrier_sum_h;
+	uint const *const barrier_sum_v = solver->barrier_sum_v;
+
+	// horizontal edge rows y0 + 1 to y1 - 1, vertical edge columns x0 + 1 to x1 - 1
+	uint const sh = width + 1;
+	uint const sv = width + 2;
+	uint const interior_h = barrier_sum_h[y1*sh + x1] - barrier_sum_h[(y0 + 1)*sh + x1] - barrier_sum_h[y1*sh + x0] + barrier_sum_h[(y0 + 1)*sh + x0];
+	uint const interior_v = barrier_sum_v[y1*sv + x1] - barrier_sum_v[y0*sv + x1] - barrier_sum_v[y1*sv + x0 + 1] + barrier_sum_v[y0*sv + x0 + 1];
+	return interior_h != 0 || interior_v != 0;
+}
+
+void parity_count_islands(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1, uint island_count)
+{
+	uint const width = board->width;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint const *const cells = solver->tmp2;
+	parity_counts_t *const counts = solver->island_counts;
+
+	uint const w = x1 - x0;
+	uint const h = y1 - y0;
+
+	// count cells of all islands in one pass
+	memset(counts, 0, (island_count + 1)*sizeof(parity_counts_t));
+	for (uint y = 0; y < h; ++y)
+	for (uint x = 0; x < w; ++x) {
+		uint const p = parity(x0 + x, y0 + y);
+		++counts[cells[y*w + x]].cell_count[p];
+	}
+
+	// count available edges around the block for the island inside each one
+	for (uint i = 0; i < w; ++i) {
+		{
+			uint const k = y0*width + x0 + i;
+			uint const p = parity(x0 + i, y0);
+			parity_counts_t *const c = counts + cells[i];
+			c->available_count[p] += (edge_h[k] & EDGE_BARRIER) ? 0 : 1;
+			c->path_count[p] += (edge_h[k] & EDGE_PATH) ? 1 : 0;
+		}
+		{
+			uint const k = y1*width + x0 + i;
+			uint const p = parity(x0 + i, y1 - 1);
+			parity_counts_t *const c = counts + cells[(h - 1)*w + i];
+			c->available_count[p] += (edge_h[k] & EDGE_BARRIER) ? 0 : 1;
+			c->path_count[p] += (edge_h[k] & EDGE_PATH) ? 1 : 0;
+		}
+	}
+	for (uint i = 0; i < h; ++i) {
+		{
+			uint const k = (y0 + i)*(width + 1) + x0;
+			uint const p = parity(x0, y0 + i);
+			parity_counts_t *const c = counts + cells[i*w];
+			c->available_count[p] += (edge_v[k] & EDGE_BARRIER) ? 0 : 1;
+			c->path_count[p] += (edge_v[k] & EDGE_PATH) ? 1 : 0;
+		}
+		{
+			uint const k = (y0 + i)*(width + 1) + x1;
+			uint const p = parity(x1 - 1, y0 + i);
+			parity_counts_t *const c = counts + cells[i*w + (w - 1)];
+			c->available_count[p] += (edge_v[k] & EDGE_BARRIER) ? 0 : 1;
+			c->path_count[p] += (edge_v[k] & EDGE_PATH) ? 1 : 0;
+		}
+	}
+}
+
+// the island's counts come from the decided perimeter edges next to it and the barriers
+// that separate it from the rest of the block
+static
+void justify_island(justify_t *justify, board_t const *board, uint const *cells, uint x0, uint y0, uint x1, uint y1, uint island_index)
+{
+	uint const width = board->width;
+	uint const edge_count_h = width*(board->height + 1);
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint const w = x1 - x0;
+	uint const h = y1 - y0;
+	for (uint y = 0; y < h; ++y)
+	for (uint x = 0; x < w; ++x) {
+		if (cells[y*w + x] != island_index) {
+			continue;
+		}
+		uint const kh = (y0 + y)*width + x0 + x;
+		uint const kv = (y0 + y)*(width + 1) + x0 + x;
+		bool const is_edge[4] = {
+			(y == 0) ? (edge_h[kh] & (EDGE_BARRIER | EDGE_PATH)) != 0 : cells[(y - 1)*w + x] != island_index,
+			(y == h - 1) ? (edge_h[kh + width] & (EDGE_BARRIER | EDGE_PATH)) != 0 : cells[(y + 1)*w + x] != island_index,
+			(x == 0) ? (edge_v[kv] & (EDGE_BARRIER | EDGE_PATH)) != 0 : cells[y*w + x - 1] != island_index,
+			(x == w - 1) ? (edge_v[kv + 1] & (EDGE_BARRIER | EDGE_PATH)) != 0 : cells[y*w + x + 1] != island_index
+		};
+		uint const ids[4] = { kh, kh + width, edge_count_h + kv, edge_count_h + kv + 1 };
+		for (uint i = 0; i < 4; ++i) {
+			if (is_edge[i]) {
+				justify_premise(justify, ids[i]);
+			}
+		}
+	}
+}
+
+static inline
+void parity_set_edge(solver_t const *solver, board_t const *board, uint const *e, uint k, bool make_path, bool make_barrier)
+{
+	uint const old = *e;
+	if (make_path && (old & EDGE_BARRIER) == 0) {
+		decide_edge(solver, board, k, EDGE_PATH);
+	} else if (make_barrier && (old & EDGE_PATH) == 0) {
+		decide_edge(solver, board, k, EDGE_BARRIER);
+	}
+	if (solver->justify && *e != old) {
+		justify_decided(solver->justify, k);
+	}
+}
+
+step_t parity_check_block_island(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1, uint island_index, parity_counts_t const *counts)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint *const edge_h = board->edge_h;
+	uint *const edge_v = board->edge_v;
+	uint const *const cells = solver->tmp2;
+	uint const *const cell_count = counts->cell_count;
+	uint const *const available_count = counts->available_count;
+	uint const *const path_count = counts->path_count;
+
+	uint const w = x1 - x0;
+	uint const h = y1 - y0;
+
+	uint const min_cell_count = min(cell_count[0], cell_count[1]);
+	uint const extra_cells[2] = {
+		cell_count[0] - min_cell_count,
+		cell_count[1] - min_cell_count
+	};
+	if (available_count[0] < 2*extra_cells[0] || available_count[1] < 2*extra_cells[1]) {
+		return STEP_CONTRADICTION;
+	}
+
+	uint const min_count[2] = {
+		1 + extra_cells[0] - extra_cells[1],
+		1 + extra_cells[1] - extra_cells[0],
+	};
+
+	uint max_count[2] = {
+		min(available_count[0], available_count[1] + 2*(extra_cells[0] - extra_cells[1])),
+		min(available_count[1], available_count[0] + 2*(extra_cells[1] - extra_cells[0]))
+	};
+	if (cell_count[0] + cell_count[1] == width*height) {
+		max_count[0] = min(max_count[0], min_count[0]);
+		max_count[1] = min(max_count[1], min_count[1]);
+	}
+
+	bool const only_path_min_available[2] = {
+		available_count[0] == min_count[0] && path_count[0] < min_count[0],
+		available_count[1] == min_count[1] && path_count[1] < min_count[1]
+	};
+	bool const other_parity_used_path_max[2] = {
+		path_count[1] == max_count[1] && available_count[0] == max_count[0] && path_count[0] < max_count[0],
+		path_count[0] == max_count[0] && available_count[1] == max_count[1] && path_count[1] < max_count[1]
+	};
+
+	bool const make_path[2] = {
+		only_path_min_available[0] || other_parity_used_path_max[0],
+		only_path_min_available[1] || other_parity_used_path_max[1],
+	};
+	bool const make_barrier[2] = {
+		path_count[0] == max_count[0] && available_count[0] > max_count[0],
+		path_count[1] == max_count[1] && available_count[1] > max_count[1]
+	};
+
+	if (!(make_path[0] || make_path[1] || make_barrier[0] || make_barrier[1])) {
+		return STEP_NONE;
+	}
+
+	justify_t *const justify = solver->justify;
+	if (justify) {
+		justify_island(justify, board, cells, x0, y0, x1, y1, island_index);
+	}
+	uint const edge_count_h = width*(height + 1);
+	for (uint i = 0; i < w; ++i) {
+		if (cells[i] == island_index) {
+			uint const k = y0*width + x0 + i;
+			uint const p = parity(x0 + i, y0);
+			parity_set_edge(solver, board, edge_h + k, k, make_path[p], make_barrier[p]);
+		}
+		if (cells[(h - 1)*w + i] == island_index) {
+			uint const k = y1*width + x0 + i;
+			uint const p = parity(x0 + i, y1 - 1);
+			parity_set_edge(solver, board, edge_h + k, k, make_path[p], make_barrier[p]);
+		}
+	}
+	for (uint i = 0; i < h; ++i) {
+		if (cells[i*w] == island_index) {
+			uint const k = (y0 + i)*(width + 1) + x0;
+			uint const p = parity(x0, y0 + i);
+			parity_set_edge(solver, board, edge_v + k, edge_count_h + k, make_path[p], make_barrier[p]);
+		}
+		if (cells[i*w + w - 1] == island_index) {
+			uint const k = (y0 + i)*(width + 1) + x1;
+			uint const p = parity(x1 - 1, y0 + i);
+			parity_set_edge(solver, board, edge_v + k, edge_count_h + k, make_path[p], make_barrier[p]);
+		}
+	}
+	if (justify) {
+		justify_end(justify);
+	}
+
+	if (solver->verbose) {
+		uint *const highlights = solver->tmp1;
+		memset(highlights, 0, width*height*sizeof(uint));
+		for (uint y = 0; y < h; ++y)
+		for (uint x = 0; x < w; ++x) {
+			if (cells[y*w + x] == island_index) {
+				highlights[(y0 + y)*width + (x0 + x)] = 1;
+			}
+		}
+		fputs("\nparity check:\n", stdout);
+		print_board(solver, board, EDGE_ALL | EDGE_HIGHLIGHT | EDGE_NEW);
+	}
+
+	return STEP_CHANGED;
+}
+
+step_t parity_check_block_islands(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1, parity_counts_t *counts)
+{
+	uint const width = board->width;
+	uint *const edge_h = board->edge_h;
+	uint *const edge_v = board->edge_v;
+	uint *const coords = solver->tmp1;
+	uint *const cells = solver->tmp2;
+
+	uint const w = x1 - x0;
+	uint const h = y1 - y0;
+
+	// blocks without interior barriers are a single island, count from the sums instead
+	if (!parity_block_has_interior_barriers(solver, board, x0, y0, x1, y1)) {
+		uint const p0 = parity(x0, y0);
+		counts->cell_count[p0] = (w*h + 1)/2;
+		counts->cell_count[p0 ^ 1] = w*h/2;
+		for (uint i = 0; i < w*h; ++i) {
+			cells[i] = 1;
+		}
+		return parity_check_block_island(solver, board, x0, y0, x1, y1, 1, counts);
+	}
+
+	memset(cells, 0, w*h*sizeof(uint));
+
+	// colour all islands
+	uint next_island_index = 1;
+	for (uint sy = 0; sy < h; ++sy)
+	for (uint sx = 0; sx < w; ++sx) {
+		if (cells[sy*w + sx] != 0) {
+			continue;
+		}
+
+		cells[sy*w + sx] = next_island_index;
+		coords[0] = sy*w + sx;
+		uint start = 0;
+		uint end = 1;
+		while (start != end) {
+			uint const ic = coords[start];
+			uint const y = ic / w;
+			uint const x = ic - y*w;
+			uint const ih = (y0 + y)*width + (x0 + x);
+			uint const iv = (y0 + y)*(width + 1) + (x0 + x);
+
+			if (x > 0 && cells[ic - 1] == 0 && (edge_v[iv] & EDGE_BARRIER) == 0) {
+				cells[ic - 1] = next_island_index;
+				coords[end++] = ic - 1;
+			}
+			if (x < w - 1 && cells[ic + 1] == 0 && (edge_v[iv + 1] & EDGE_BARRIER) == 0) {
+				cells[ic + 1] = next_island_index;
+				coords[end++] = ic + 1;
+			}
+			if (y > 0 && cells[ic - w] == 0 && (edge_h[ih] & EDGE_BARRIER) == 0) {
+				cells[ic - w] = next_island_index;
+				coords[end++] = ic - w;
+			}
+			if (y < h - 1 && cells[ic + w] == 0 && (edge_h[ih + width] & EDGE_BARRIER) == 0) {
+				cells[ic + w] = next_island_index;
+				coords[end++] = ic + w;
+			}
+
+			++start;
+		}
+		++next_island_index;
+	}
+
+	// solve each one
+	parity_count_islands(solver, board, x0, y0, x1, y1, next_island_index - 1);
+	for (uint i = 1; i < next_island_index; ++i) {
+		step_t const step = parity_check_block_island(solver, board, x0, y0, x1, y1, i, solver->island_counts + i);
+		if (step != STEP_NONE) {
+			return step;
+		}
+	}
+	return STEP_NONE;
+}
+
+step_t parity_check_block(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1)
+{
+	// deductions only ever decide perimeter edges, so skip blocks where these are all decided
+	parity_counts_t counts;
+	parity_count_block_perimeter(solver, board, x0, y0, x1, y1, &counts);
+	uint const undecided_count = counts.available_count[0] + counts.available_count[1] - counts.path_count[0] - counts.path_count[1];
+	if (undecided_count == 0) {
+		return STEP_NONE;
+	}
+
+	// the result depends only on the block's own edges, so a block that deduced nothing
+	// before deduces nothing again while they hash the same, on any board of this size
+	uint64_t const hash = parity_block_hash(solver, board, x0, y0, x1, y1);
+	if (parity_cache_contains(solver, hash)) {
+		if (solver->stats) {
+			++solver->stats->parity_cache_hits;
+		}
+		return STEP_NONE;
+	}
+	step_t const step = parity_check_block_islands(solver, board, x0, y0, x1, y1, &counts);
+	if (step == STEP_NONE) {
+		parity_cache_insert(solver, hash);
+	}
+	return step;
+}
+
+step_t parity_check_all_blocks(solver_t const *solver, board_t const *board, uint w, uint h)
+{
+	uint const xn = board->width - w;
+	uint const yn = board->height - h;
+
+	// when event-driven, only check blocks that changed since this size last found nothing
+	uint clean = 0;
+	if (solver->worklist && !solver->justify) {
+		clean = solver->worklist->size_clean[h*(board->width + 1) + w];
+		if (clean != 0) {
+			build_dirty_sums(solver, board, clean);
+		}
+	}
+	if (solver->sweep && (uint64_t)(xn + 1)*(yn + 1) >= PARITY_SWEEP_MIN_BLOCKS) {
+		if (solver->schedule) {
+			solver->schedule->visit_count += (uint64_t)(xn + 1)*(yn + 1);
+		}
+		return sweep_parity_blocks(solver->sweep, solver, board, (h - 2)*(board->width - 1) + (w - 2), 1, clean);
+	}
+
+	uint64_t checked_count = 0;
+	step_t step = STEP_NONE;
+	for (uint y = 0; y <= yn && step == STEP_NONE; ++y)
+	for (uint x = 0; x <= xn; ++x) {
+		if (clean != 0 && !parity_block_is_dirty(solver, board, x, y, x + w, y + h)) {
+			continue;
+		}
+		++checked_count;
+		step = parity_check_block(solver, board, x, y, x + w, y + h);
+		if (step != STEP_NONE) {
+			break;
+		}
+	}
+	if (solver->stats) {
+		solver->stats->parity_block_counts[h*(solver->stats->max_width + 1) + w] += checked_count;
+	}
+	if (solver->schedule) {
+		solver->schedule->visit_count += checked_count;
+	}
+	return step;
+}
+
+// sums and hashes every block size reads, once per board state
+static
+void begin_parity_sweep(solver_t const *solver, board_t const *board)
+{
+	build_parity_sums(solver, board);
+	build_state_hashes(solver, board);
+}
+
+static
+step_t parity_check_block_size(solver_t const *solver, board_t const *board, uint w, uint h)
+{
+	step_t const step = parity_check_all_blocks(solver, board, w, h);
+	if (step == STEP_NONE && solver->worklist && !solver->justify) {
+		solver->worklist->size_clean[h*(board->width + 1) + w] = solver->worklist->generation;
+	}
+	return step;
+}
+
+step_t parity_check_all_block_sizes(solver_t const *solver, board_t const *board)
+{
+	begin_parity_sweep(solver, board);
+
+	// all sizes in one round, unless each size has its own dirty blocks
+	uint64_t const block_count = ((uint64_t)board->width*(board->width - 1)/2)*((uint64_t)board->height*(board->height - 1)/2);
+	if (solver->sweep && !solver->worklist && block_count >= PARITY_SWEEP_MIN_BLOCKS) {
+		return sweep_parity_blocks(solver->sweep, solver, board, 0, (board->width - 1)*(board->height - 1), 0);
+	}
+	for (uint h = 2; h <= board->height; ++h)
+	for (uint w = 2; w <= board->width; ++w) {
+		step_t const step = parity_check_block_size(solver, board, w, h);
+		if (step != STEP_NONE) {
+			return step;
+		}
+	}
+	return STEP_NONE;
+}
+
+typedef struct
+{
+	uint exit_path_count;
+	uint exit_path_indices[2];
+	uint path_count;
+	uint exit_path_length_total;
+} path_labels_t;
+
+// flood fill each path segment, leaves the segment index for each cell in tmp2, false if more than 2 paths exit
+bool label_paths_flood(solver_t const *solver, board_t const *board, path_labels_t *labels)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint *const coords = solver->tmp1;
+	uint *const cells = solver->tmp2;
+
+	memset(cells, 0, width*height*sizeof(uint));
+
+	// colour all paths
+	uint exit_path_count = 0;
+	uint exit_path_indices[2] = { 0, 0 };
+	uint next_path_index = 1;
+	for (uint sy = 0; sy < height; ++sy)
+	for (uint sx = 0; sx < width; ++sx) {
+		if (cells[sy*width + sx] != 0) {
+			continue;
+		}
+
+		uint all_path_bits = 0;
+		all_path_bits |= edge_h[sy*width + sx];
+		all_path_bits |= edge_h[(sy + 1)*width + sx];
+		all_path_bits |= edge_v[sy*(width + 1) + sx];
+		all_path_bits |= edge_v[sy*(width + 1) + sx + 1];
+		if ((all_path_bits & EDGE_PATH) == 0) {
+			continue;
+		}
+
+		cells[sy*width + sx] = next_path_index;
+		coords[0] = sy*width + sx;
+		uint start = 0;
+		uint end = 1;
+		while (start != end) {
+			uint const ic = coords[start];
+			uint const y = ic / width;
+			uint const x = ic - y*width;
+			uint const ih = ic;
+			uint const iv = y*(width + 1) + x;
+
+			if (edge_v[iv] & EDGE_PATH) {
+				if (x == 0) {
+					if (exit_path_count == 2) {
+						return false;
+					}
+					exit_path_indices[exit_path_count++] = next_path_index;
+				} else if (cells[ic - 1] == 0) {
+					cells[ic - 1] = next_path_index;
+					coords[end++] = ic - 1;
+				}
+			}
+			if (edge_v[iv + 1] & EDGE_PATH) {
+				if (x + 1 == width) {
+					if (exit_path_count == 2) {
+						return false;
+					}
+					exit_path_indices[exit_path_count++] = next_path_index;
+				} else if (cells[ic + 1] == 0) {
+					cells[ic + 1] = next_path_index;
+					coords[end++] = ic + 1;
+				}
+			}
+			if (edge_h[ih] & EDGE_PATH) {
+				if (y == 0) {
+					if (exit_path_count == 2) {
+						return false;
+					}
+					exit_path_indices[exit_path_count++] = next_path_index;
+				} else if (cells[ic - width] == 0) {
+					cells[ic - width] = next_path_index;
+					coords[end++] = ic - width;
+				}
+			}
+			if (edge_h[ih + width] & EDGE_PATH) {
+				if (y + 1 == height) {
+					if (exit_path_count == 2) {
+						return false;
+					}
+					exit_path_indices[exit_path_count++] = next_path_index;
+				} else if (cells[ic + width] == 0) {
+					cells[ic + width] = next_path_index;
+					coords[end++] = ic + width;
+				}
+			}
+
+			++start;
+		}
+		++next_path_index;
+	}
+
+	// count path lengths
+	uint exit_path_length_total = 0;
+	for (uint i = 0; i < width*height; ++i) {
+		uint const index = cells[i];
+		if ((exit_path_count > 0 && exit_path_indices[0] == index) || (exit_path_count > 1 && exit_path_indices[1] == index)) {
+			++exit_path_length_total;
+		}
+	}
+
+	labels->exit_path_count = exit_path_count;
+	labels->exit_path_indices[0] = exit_path_indices[0];
+	labels->exit_path_indices[1] = exit_path_indices[1];
+	labels->path_count = next_path_index - 1;
+	labels->exit_path_length_total = exit_path_length_total;
+	return true;
+}
+
+// read segment indices from the union-find maintained by sync_worklist, same results as the flood fill
+bool label_paths_union_find(solver_t const *solver, board_t const *board, path_labels_t *labels)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint *const cells = solver->tmp2;
+	worklist_t *const worklist = solver->worklist;
+	uint *const parent = worklist->path_parent;
+
+	for (uint i = 0; i < width*height; ++i) {
+		cells[i] = (parent[i] == NOT_ON_PATH) ? 0 : (find_root(parent, i) + 1);
+	}
+
+	uint const exit_path_count = worklist->exit_count;
+	if (exit_path_count > 2) {
+		return false;
+	}
+	uint exit_path_length_total = 0;
+	for (uint i = 0; i < exit_path_count; ++i) {
+		uint const root = find_root(parent, worklist->exit_cells[i]);
+		labels->exit_path_indices[i] = root + 1;
+		if (i == 0 || labels->exit_path_indices[0] != root + 1) {
+			exit_path_length_total += worklist->path_size[root];
+		}
+	}
+	for (uint i = exit_path_count; i < 2; ++i) {
+		labels->exit_path_indices[i] = 0;
+	}
+	labels->exit_path_count = exit_path_count;
+	labels->path_count = worklist->path_count;
+	labels->exit_path_length_total = exit_path_length_total;
+	return true;
+}
+
+// segment index of a cell, 0 if it has no path edges: from the labels, or from the union-find without them
+static inline
+uint segment_index_of(solver_t const *solver, uint const *cells, uint i)
+{
+	if (cells) {
+		return cells[i];
+	}
+	uint *const parent = solver->worklist->path_parent;
+	return (parent[i] == NOT_ON_PATH) ? 0 : (find_root(parent, i) + 1);
+}
+
+// for a cell where 2 out of 3 available edges would make a loop, add a path edge for the remaining one
+static
+bool check_loop_cell(solver_t const *solver, board_t const *board, uint const *cells, uint *highlights, uint x, uint y)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint *const edge_h = board->edge_h;
+	uint *const edge_v = board->edge_v;
+
+	// get adjacent edges
+	uint *edges[4];
+	edges[0] = edge_h + y*width + x;
+	edges[1] = edges[0] + width;
+	edges[2] = edge_v + y*(width + 1) + x;
+	edges[3] = edges[2] + 1;
+
+	// get derived stuff
+	uint available_count = 0;
+	uint barrier_index = 0;
+	uint barrier_count = 0;
+	for (uint i = 0; i < 4; ++i) {
+		uint const e = *edges[i];
+		if (e & EDGE_BARRIER) {
+			++barrier_count;
+			barrier_index = i;
+		} else if ((e & EDGE_PATH) == 0) {
+			++available_count;
+		}
+	}
+	if (barrier_count != 1 || available_count != 3) {
+		return false;
+	}
+
+	// get adjacent cells and their path index in matching order
+	uint adj[4];
+	uint index[4];
+	for (int i = 0; i < 4; ++i) {
+		uint const px = (uint)((int)x + ((i >= 2) ? (2*i - 5) : 0));
+		uint const py = (uint)((int)y + ((i < 2) ? (2*i - 1) : 0));
+		if (px < width && py < height) {
+			adj[i] = py*width + px;
+			index[i] = segment_index_of(solver, cells, adj[i]);
+		} else {
+			adj[i] = NOT_ON_PATH;
+			index[i] = 0;
+		}
+	}
+
+	// find two matching path ends over available edges, select the other available edge
+	uint const offsets[] = { 1, 2, 3, 1, 2 };
+	uint new_index = 4;
+	uint segment_index = 0;
+	for (uint k = 0; k < 3; ++k) {
+		uint const i0 = (barrier_index + offsets[k + 0]) % 4;
+		uint const i1 = (barrier_index + offsets[k + 1]) % 4;
+		uint const i2 = (barrier_index + offsets[k + 2]) % 4;
+		if (index[i0] != 0 && index[i0] == index[i1]) {
+			new_index = i2;
+			segment_index = index[i0];
+			break;
+		}
+	}
+
+	if (new_index == 4) {
+		return false;
+	}
+
+	// force the other edge to be a path
+	uint const edge_count_h = width*(height + 1);
+	uint const new_k = (new_index < 2) ? (uint)(edges[new_index] - edge_h) : edge_count_h + (uint)(edges[new_index] - edge_v);
+	decide_edge(solver, board, new_k, EDGE_PATH);
+	if (solver->justify) {
+		uint const barrier_k = (barrier_index < 2) ? (uint)(edges[barrier_index] - edge_h) : edge_count_h + (uint)(edges[barrier_index] - edge_v);
+		justify_premise(solver->justify, barrier_k);
+		justify_premise_segment(solver->justify, segment_index);
+		justify_decided(solver->justify, new_k);
+		justify_end(solver->justify);
+	}
+	if (solver->verbose) {
+		highlights[y*width + x] = 1;
+		for (uint i = 0; i < 4; ++i) {
+			if (i == barrier_index || i == new_index) {
+				continue;
+			}
+			if (adj[i] != NOT_ON_PATH) {
+				highlights[adj[i]] = 1;
+			}
+		}
+	}
+	return true;
+}
+
+// a barrier that stops one or two path segments joining up follows from their edges
+static
+void justify_segments_decided(justify_t *justify, uint index, uint other_index, uint k)
+{
+	justify_premise_segment(justify, index);
+	if (other_index != index) {
+		justify_premise_segment(justify, other_index);
+	}
+	justify_decided(justify, k);
+	justify_end(justify);
+}
+
+step_t check_loops(solver_t const *solver, board_t const *board, bool *is_solved)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint *const edge_h = board->edge_h;
+	uint *const edge_v = board->edge_v;
+	uint *const cells = solver->tmp2;
+	uint *const highlights = solver->tmp1;
+
+	// colour all paths
+	path_labels_t labels;
+	bool const is_labelled = solver->worklist && !solver->justify ? label_paths_union_find(solver, board, &labels) : label_paths_flood(solver, board, &labels);
+	if (!is_labelled) {
+		return STEP_CONTRADICTION;
+	}
+	uint const exit_path_count = labels.exit_path_count;
+	uint exit_path_indices[2] = { labels.exit_path_indices[0], labels.exit_path_indices[1] };
+	uint const exit_path_length_total = labels.exit_path_length_total;
+	memset(highlights, 0, width*height*sizeof(uint));
+	justify_t *const justify = solver->justify;
+	uint const edge_count_h = width*(height + 1);
+	if (justify) {
+		justify_segments(justify, board, cells, labels.path_count);
+	}
+
+	// early out if solved completely
+	*is_solved = (exit_path_count == 2 && labels.path_count == 1 && exit_path_length_total == width*height);
+	if (*is_solved) {
+		return STEP_NONE;
+	}
+
+	// add barriers to prevent loops or short paths
+	bool changed = false;
+	for (uint y = 0; y < height; ++y)
+	for (uint x = 0; x < width; ++x) {
+		uint const index = cells[y*width + x];
+		if (index == 0) {
+			continue;
+		}
+		bool const is_exit = (exit_path_length_total < width*height && exit_path_count == 2 && (index == exit_path_indices[0] || index == exit_path_indices[1]));
+
+		uint const kv = y*(width + 1) + x + 1;
+		uint const kh = (y + 1)*width + x;
+
+		if (x + 1 < width && (edge_v[kv] & EDGE_PATH) == 0) {
+			uint const other_index = cells[y*width + x + 1];
+			bool const other_is_exit = (exit_path_count == 2 && (other_index == exit_path_indices[0] || other_index == exit_path_indices[1]));
+			if ((index == other_index || (is_exit && other_is_exit)) && (edge_v[kv] & EDGE_BARRIER) == 0) {
+				decide_edge(solver, board, edge_count_h + kv, EDGE_BARRIER);
+				changed = true;
+				if (justify) {
+					justify_segments_decided(justify, index, other_index, edge_count_h + kv);
+				}
+			}
+		}
+		if (y + 1 < height && (edge_h[kh] & EDGE_PATH) == 0) {
+			uint const other_index = cells[(y + 1)*width + x];
+			bool const other_is_exit = (exit_path_count == 2 && (other_index == exit_path_indices[0] || other_index == exit_path_indices[1]));
+			if ((index == other_index || (is_exit && other_is_exit)) && (edge_h[kh] & EDGE_BARRIER) == 0) {
+				decide_edge(solver, board, kh, EDGE_BARRIER);
+				changed = true;
+				if (justify) {
+					justify_segments_decided(justify, index, other_index, kh);
+				}
+			}
+		}
+	}
+
+	// candidate cells come from the kernel, setting a path edge only ever rules a cell out
+	cell_kernels_t const *const kernels = solver->kernels;
+	for (uint y = 0; y < height; ++y)
+	for (uint x0 = 0; x0 < width; x0 += 64) {
+		uint const count = min(width - x0, 64);
+		uint64_t candidates = kernels->loop_cells(edge_h + y*width + x0, edge_h + (y + 1)*width + x0, edge_v + y*(width + 1) + x0, cells + y*width + x0, count);
+		for (; candidates != 0; candidates &= candidates - 1) {
+			uint const x = x0 + (uint)__builtin_ctzll(candidates);
+			if (check_loop_cell(solver, board, cells, highlights, x, y)) {
+				changed = true;
+			}
+		}
+	}
+
+	// add barrier to prevent early exits
+	if (exit_path_count > 0 && exit_path_length_total < width*height) {
+		if (exit_path_count == 1) {
+			exit_path_indices[1] = exit_path_indices[0];
+		}
+		for (uint x = 0; x < width; ++x) {
+			uint const index0 = cells[x];
+			uint const index1 = cells[(height - 1)*width + x];
+			bool const is_exit0 = (index0 == exit_path_indices[0] || index0 == exit_path_indices[1]);
+			bool const is_exit1 = (index1 == exit_path_indices[0] || index1 == exit_path_indices[1]);
+			uint const k0 = x;
+			uint const k1 = height*width + x;
+			if (is_exit0 && (edge_h[k0] & (EDGE_BARRIER | EDGE_PATH)) == 0) {
+				decide_edge(solver, board, k0, EDGE_BARRIER);
+				changed = true;
+				if (justify) {
+					justify_segments_decided(justify, exit_path_indices[0], exit_path_indices[1], k0);
+				}
+			}
+			if (is_exit1 && (edge_h[k1] & (EDGE_BARRIER | EDGE_PATH)) == 0) {
+				decide_edge(solver, board, k1, EDGE_BARRIER);
+				changed = true;
+				if (justify) {
+					justify_segments_decided(justify, exit_path_indices[0], exit_path_indices[1], k1);
+				}
+			}
+		}
+		for (uint y = 0; y < height; ++y) {
+			uint const index0 = cells[y*width];
+			uint const index1 = cells[y*width + width - 1];
+			bool const is_exit0 = (index0 == exit_path_indices[0] || index0 == exit_path_indices[1]);
+			bool const is_exit1 = (index1 == exit_path_indices[0] || index1 == exit_path_indices[1]);
+			uint const k0 = y*(width + 1);
+			uint const k1 = y*(width + 1) + width;
+			if (is_exit0 && (edge_v[k0] & (EDGE_BARRIER | EDGE_PATH)) == 0) {
+				decide_edge(solver, board, edge_count_h + k0, EDGE_BARRIER);
+				changed = true;
+				if (justify) {
+					justify_segments_decided(justify, exit_path_indices[0], exit_path_indices[1], edge_count_h + k0);
+				}
+			}
+			if (is_exit1 && (edge_v[k1] & (EDGE_BARRIER | EDGE_PATH)) == 0) {
+				decide_edge(solver, board, edge_count_h + k1, EDGE_BARRIER);
+				changed = true;
+				if (justify) {
+					justify_segments_decided(justify, exit_path_indices[0], exit_path_indices[1], edge_count_h + k1);
+				}
+			}
+		}
+	}
+
+	if (solver->verbose && changed) {
+		fputs("\navoid loops and short paths:\n", stdout);
+		print_board(solver, board, EDGE_ALL | EDGE_HIGHLIGHT | EDGE_NEW);
+	}
+
+	return changed ? STEP_CHANGED : STEP_NONE;
+}
+
+static
+int compare_cells(void const *a, void const *b)
+{
+	uint const ca = *(uint const *)a;
+	uint const cb = *(uint const *)b;
+	return (ca > cb) - (ca < cb);
+}
+
+static inline
+void add_loop_candidate(worklist_t *worklist, uint *candidates, uint *candidate_count, uint i)
+{
+	if (worklist->loop_stamp[i] != worklist->loop_generation) {
+		worklist->loop_stamp[i] = worklist->loop_generation;
+		candidates[(*candidate_count)++] = i;
+	}
+}
+
+// a barrier on open edge k between a cell of segment root and cell other, if the two would close a loop or join the exits early
+static
+bool check_loop_edge(solver_t const *solver, board_t const *board, uint k, uint other, uint root, bool is_exit, uint const *exit_roots)
+{
+	uint const edge_count_h = board->width*(board->height + 1);
+	uint *const parent = solver->worklist->path_parent;
+	uint const e = (k < edge_count_h) ? board->edge_h[k] : board->edge_v[k - edge_count_h];
+	if ((e & (EDGE_PATH | EDGE_BARRIER)) != 0 || parent[other] == NOT_ON_PATH) {
+		return false;
+	}
+	uint const other_root = find_root(parent, other);
+	if (other_root != root && !(is_exit && (other_root == exit_roots[0] || other_root == exit_roots[1]))) {
+		return false;
+	}
+	decide_edge(solver, board, k, EDGE_BARRIER);
+	return true;
+}
+
+// same results as check_loops once the single cell rule has nothing left: a path cell next to an open edge is then
+// the end of its segment, so only the ends of segments that changed since the last call and cells next to them or
+// to a changed edge can have new deductions, with segments from the union-find instead of labels
+step_t check_loops_queued(solver_t const *solver, board_t const *board, bool *is_solved)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint *const candidates = solver->tmp2;
+	uint *const highlights = solver->tmp1;
+	worklist_t *const worklist = solver->worklist;
+	uint *const parent = worklist->path_parent;
+	uint const *const ends = worklist->path_ends;
+	uint const edge_count_h = width*(height + 1);
+
+	if (worklist->loops_scan_all || !worklist->paths_are_simple) {
+		worklist->loops_scan_all = false;
+		clear_loop_cells(worklist);
+		return check_loops(solver, board, is_solved);
+	}
+
+	uint const exit_path_count = worklist->exit_count;
+	if (exit_path_count > 2) {
+		clear_loop_cells(worklist);
+		return STEP_CONTRADICTION;
+	}
+	uint exit_roots[2] = { NOT_ON_PATH, NOT_ON_PATH };
+	uint exit_path_length_total = 0;
+	for (uint i = 0; i < exit_path_count; ++i) {
+		exit_roots[i] = find_root(parent, worklist->exit_cells[i]);
+		if (i == 0 || exit_roots[0] != exit_roots[1]) {
+			exit_path_length_total += worklist->path_size[exit_roots[i]];
+		}
+	}
+	*is_solved = (exit_path_count == 2 && worklist->path_count == 1 && exit_path_length_total == width*height);
+	if (*is_solved) {
+		clear_loop_cells(worklist);
+		return STEP_NONE;
+	}
+	if (solver->verbose) {
+		memset(highlights, 0, width*height*sizeof(uint));
+	}
+
+	// add barriers to prevent loops or short paths at the ends of changed segments
+	++worklist->loop_generation;
+	uint candidate_count = 0;
+	bool changed = false;
+	for (uint n = 0; n < worklist->loop_cell_count; ++n) {
+		uint const i = worklist->loop_cells[n];
+		add_loop_candidate(worklist, candidates, &candidate_count, i);
+		if (parent[i] == NOT_ON_PATH) {
+			continue;
+		}
+		uint const root = find_root(parent, i);
+		bool const is_exit = (exit_path_length_total < width*height && exit_path_count == 2 && (root == exit_roots[0] || root == exit_roots[1]));
+		for (uint j = 0; j < 2; ++j) {
+			uint const end = ends[2*root + j];
+			if (end == NOT_ON_PATH) {
+				continue;
+			}
+			uint const x = end % width;
+			uint const y = end/width;
+			uint const kv = edge_count_h + y*(width + 1) + x;
+			if (y > 0) {
+				changed |= check_loop_edge(solver, board, end, end - width, root, is_exit, exit_roots);
+				add_loop_candidate(worklist, candidates, &candidate_count, end - width);
+			}
+			if (y + 1 < height) {
+				changed |= check_loop_edge(solver, board, end + width, end + width, root, is_exit, exit_roots);
+				add_loop_candidate(worklist, candidates, &candidate_count, end + width);
+			}
+			if (x > 0) {
+				changed |= check_loop_edge(solver, board, kv, end - 1, root, is_exit, exit_roots);
+				add_loop_candidate(worklist, candidates, &candidate_count, end - 1);
+			}
+			if (x + 1 < width) {
+				changed |= check_loop_edge(solver, board, kv + 1, end + 1, root, is_exit, exit_roots);
+				add_loop_candidate(worklist, candidates, &candidate_count, end + 1);
+			}
+		}
+	}
+
+	// cells next to both ends of a segment, in the order check_loops visits them
+	qsort(candidates, candidate_count, sizeof(uint), compare_cells);
+	for (uint n = 0; n < candidate_count; ++n) {
+		if (check_loop_cell(solver, board, NULL, highlights, candidates[n] % width, candidates[n]/width)) {
+			changed = true;
+		}
+	}
+
+	// add barrier to prevent early exits from the ends of changed exit segments
+	if (exit_path_count > 0 && exit_path_length_total < width*height) {
+		if (exit_path_count == 1) {
+			exit_roots[1] = exit_roots[0];
+		}
+		for (uint n = 0; n < worklist->loop_cell_count; ++n) {
+			uint const i = worklist->loop_cells[n];
+			if (parent[i] == NOT_ON_PATH) {
+				continue;
+			}
+			uint const root = find_root(parent, i);
+			if (root != exit_roots[0] && root != exit_roots[1]) {
+				continue;
+			}
+			for (uint j = 0; j < 2; ++j) {
+				uint const end = ends[2*root + j];
+				if (end == NOT_ON_PATH) {
+					continue;
+				}
+				uint const x = end % width;
+				uint const y = end/width;
+				uint const kv = y*(width + 1) + x;
+				if (y == 0 && (edge_h[x] & (EDGE_BARRIER | EDGE_PATH)) == 0) {
+					decide_edge(solver, board, x, EDGE_BARRIER);
+					changed = true;
+				}
+				if (y + 1 == height && (edge_h[height*width + x] & (EDGE_BARRIER | EDGE_PATH)) == 0) {
+					decide_edge(solver, board, height*width + x, EDGE_BARRIER);
+					changed = true;
+				}
+				if (x == 0 && (edge_v[kv] & (EDGE_BARRIER | EDGE_PATH)) == 0) {
+					decide_edge(solver, board, edge_count_h + kv, EDGE_BARRIER);
+					changed = true;
+				}
+				if (x + 1 == width && (edge_v[kv + 1] & (EDGE_BARRIER | EDGE_PATH)) == 0) {
+					decide_edge(solver, board, edge_count_h + kv + 1, EDGE_BARRIER);
+					changed = true;
+				}
+			}
+		}
+	}
+	clear_loop_cells(worklist);
+
+	if (solver->verbose && changed) {
+		fputs("\navoid loops and short paths:\n", stdout);
+		print_board(solver, board, EDGE_ALL | EDGE_HIGHLIGHT | EDGE_NEW);
+	}
+
+	return changed ? STEP_CHANGED : STEP_NONE;
+}
+
+// a path edge that stops a partition follows from the barriers joining both its corners to the boundary
+static
+void justify_partition(justify_t *justify, board_t const *board, uint const *corners, uint c0, uint c1, uint k)
+{
+	uint const width = board->width;
+	uint const s = width + 1;
+	uint const edge_count_h = width*(board->height + 1);
+	uint const ends[2] = { c0, c1 };
+	for (uint i = 0; i < 2; ++i) {
+		for (uint c = ends[i]; corners[c] != c + 1;) {
+			uint const parent = corners[c] - 1;
+			uint const a = min(c, parent);
+			if (max(c, parent) == a + 1) {
+				justify_premise(justify, (a / s)*width + a % s);
+			} else {
+				justify_premise(justify, edge_count_h + a);
+			}
+			c = parent;
+		}
+	}
+	justify_decided(justify, k);
+	justify_end(justify);
+}
+
+bool check_partitions(solver_t const *solver, board_t const *board)
+{
+	uint const width = board->width;
+	uint const height = board->height;
+	uint *const edge_h = board->edge_h;
+	uint *const edge_v = board->edge_v;
+	uint *const corners = solver->tmp1;
+	uint *const coords = solver->tmp2;
+
+	memset(corners, 0, (width + 1)*(height + 1)*sizeof(uint));
+
+	// set initial state of flood fill from boundary, reached corners hold the corner they
+	// were reached from plus one, boundary corners themselves
+	uint end = 0;
+	uint const s = width + 1;
+	for (uint x = 1; x < width; ++x) {
+		corners[x] = x + 1;
+		corners[height*s + x] = height*s + x + 1;
+		coords[end++] = x;
+		coords[end++] = height*s + x;
+	}
+	for (uint y = 1; y < height; ++y) {
+		corners[y*s] = y*s + 1;
+		corners[y*s + width] = y*s + width + 1;
+		coords[end++] = y*s;
+		coords[end++] = y*s + width;
+	}
+
+	// do flood fill along edges, the queue holds corner indices
+	uint start = 0;
+	while (start != end) {
+		uint const i = coords[start];
+		uint const y = i / s;
+		uint const x = i - y*s;
+		uint const ih = y*width + x;
+		uint const iv = i;
+
+		if (x > 0 && corners[i - 1] == 0 && (edge_h[ih - 1] & EDGE_BARRIER)) {
+			corners[i - 1] = i + 1;
+			coords[end++] = i - 1;
+		}
+		if (x < width && corners[i + 1] == 0 && (edge_h[ih] & EDGE_BARRIER)) {
+			corners[i + 1] = i + 1;
+			coords[end++] = i + 1;
+		}
+		if (y > 0 && corners[i - s] == 0 && (edge_v[iv - s] & EDGE_BARRIER)) {
+			corners[i - s] = i + 1;
+			coords[end++] = i - s;
+		}
+		if (y < height && corners[i + s] == 0 && (edge_v[iv] & EDGE_BARRIER)) {
+			corners[i + s] = i + 1;
+			coords[end++] = i + s;
+		}
+
+		++start;
+	}
+
+	// check for barriers that would partition the board
+	bool changed = false;
+	for (uint y = 1; y < height; ++y)
+	for (uint x = 0; x < width; ++x) {
+		uint const ih = y*width + x;
+		uint const i = y*(width + 1) + x;
+		uint const iv = i;
+		if ((edge_h[ih] & (EDGE_BARRIER | EDGE_PATH)) == 0 && corners[iv] && corners[iv + 1]) {
+			decide_edge(solver, board, ih, EDGE_PATH);
+			changed = true;
+			if (solver->justify) {
+				justify_partition(solver->justify, board, corners, iv, iv + 1, ih);
+			}
+		}
+	}
+	for (uint y = 0; y < height; ++y)
+	for (uint x = 1; x < width; ++x) {
+		uint const i = y*(width + 1) + x;
+		uint const iv = i;
+		uint const s = width + 1;
+		if ((edge_v[iv] & (EDGE_BARRIER | EDGE_PATH)) == 0 && corners[iv] && corners[iv + s]) {
+			decide_edge(solver, board, width*(height + 1) + iv, EDGE_PATH);
+			changed = true;
+			if (solver->justify) {
+				justify_partition(solver->justify, board, corners, iv, iv + s, width*(height + 1) + iv);
+			}
+		}
+	}
+
+	if (changed && solver->verbose) {
+		fputs("\navoid partitioning:\n", stdout);
+		print_board(solver, board, EDGE_ALL | EDGE_NEW);
+	}
+
+	return changed;
+}
+
+// sets the edges queued by add_barrier_edge, same results as check_partitions
+bool check_partitions_queued(solver_t const *solver, board_t const *board)
+{
+	uint const edge_h_count = board->width*(board->height + 1);
+	uint *const edge_h = board->edge_h;
+	uint *const edge_v = board->edge_v;
+	worklist_t *const worklist = solver->worklist;
+
+	bool changed = false;
+	for (uint i = 0; i < worklist->partition_edge_count; ++i) {
+		uint const k = worklist->partition_edges[i];
+		uint const *const e = (k < edge_h_count) ? (edge_h + k) : (edge_v + k - edge_h_count);
+		if ((*e & (EDGE_BARRIER | EDGE_PATH)) == 0) {
+			decide_edge(solver, board, k, EDGE_PATH);
+			changed = true;
+		}
+	}
+	worklist->partition_edge_count = 0;
+
+	if (changed && solver->verbose) {
+		fputs("\navoid partitioning:\n", stdout);
+		print_board(solver, board, EDGE_ALL | EDGE_NEW);
+	}
+
+	return changed;
+}
+
+static inline
+uint64_t begin_rule(solver_t const *solver)
+{
+	return solver->stats ? read_cycles() : 0;
+}
+
+// counters and trace, the trace scan happens outside the timed region and only when the rule succeeded
+static
+void end_rule(solver_t const *solver, board_t const *board, rule_t rule, uint64_t start, bool changed)
+{
+	if (changed && solver->trace) {
+		trace_step(solver->trace, board, rule);
+	}
+	stats_t *const stats = solver->stats;
+	if (!stats) {
+		return;
+	}
+	rule_stats_t *const rule_stats = stats->rules + rule;
+	++rule_stats->call_count;
+	rule_stats->cycle_count += read_cycles() - start;
+	if (changed) {
+		++rule_stats->success_count;
+	}
+	rule_stats->edge_count += stats->decided_count;
+	stats->decided_count = 0;
+}
+
+// only revisits cells, path segments and parity blocks touching edges that changed in earlier steps
+uint solve_event_driven(solver_t const *solver, board_t const *board, solve_status_t *status)
+{
+	reset_worklist(solver, board);
+
+	step_t step = STEP_NONE;
+	bool is_solved = false;
+	uint step_count = 0;
+	for (;; ++step_count) {
+		if (step_count > 0) {
+			sync_worklist(solver, board);
+		}
+
+		uint64_t start = begin_rule(solver);
+		bool changed = check_single_cells_queued(solver, board);
+		end_rule(solver, board, RULE_SINGLE_CELLS, start, changed);
+		if (changed) {
+			continue;
+		}
+
+		start = begin_rule(solver);
+		step = check_loops_queued(solver, board, &is_solved);
+		end_rule(solver, board, RULE_LOOPS, start, step == STEP_CHANGED);
+		if (step == STEP_CHANGED) {
+			continue;
+		}
+		if (is_solved || step == STEP_CONTRADICTION) {
+			break;
+		}
+
+		start = begin_rule(solver);
+		changed = check_partitions_queued(solver, board);
+		end_rule(solver, board, RULE_PARTITIONS, start, changed);
+		if (changed) {
+			continue;
+		}
+
+		start = begin_rule(solver);
+		step = parity_check_all_block_sizes(solver, board);
+		end_rule(solver, board, RULE_PARITY, start, step == STEP_CHANGED);
+		if (step == STEP_CHANGED) {
+			continue;
+		}
+
+		break;
+	}
+	*status = (step == STEP_CONTRADICTION) ? SOLVE_CONTRADICTION : is_solved ? SOLVE_SOLVED : SOLVE_GIVEN_UP;
+	if (solver->stats) {
+		solver->stats->step_count += step_count;
+	}
+	if (solver->trace) {
+		trace_end(solver->trace, *status, step_count);
+	}
+	return step_count;
+}
+
+// every block of every size once, going on past each deduction with the sums rebuilt
+static
+step_t parity_check_every_block(solver_t const *solver, board_t const *board)
+{
+	step_t result = STEP_NONE;
+	begin_parity_sweep(solver, board);
+	for (uint h = 2; h <= board->height; ++h)
+	for (uint w = 2; w <= board->width; ++w) {
+		uint64_t checked_count = 0;
+		for (uint y = 0; y + h <= board->height; ++y)
+		for (uint x = 0; x + w <= board->width; ++x) {
+			++checked_count;
+			step_t const step = parity_check_block(solver, board, x, y, x + w, y + h);
+			if (step == STEP_CONTRADICTION) {
+				return step;
+			}
+			if (step == STEP_CHANGED) {
+				result = STEP_CHANGED;
+				begin_parity_sweep(solver, board);
+			}
+		}
+		if (solver->stats) {
+			solver->stats->parity_block_counts[h*(solver->stats->max_width + 1) + w] += checked_count;
+		}
+	}
+	return result;
+}
+
+// one pass of a rule over the whole board, for rounds where each rule has its own copy of it
+step_t run_rule(solver_t const *solver, board_t const *board, rule_t rule, bool *is_solved)
+{
+	*is_solved = false;
+	if (rule == RULE_SINGLE_CELLS) {
+		return check_single_cells(solver, board) ? STEP_CHANGED : STEP_NONE;
+	}
+	if (rule == RULE_LOOPS) {
+		return check_loops(solver, board, is_solved);
+	}
+	if (rule == RULE_PARTITIONS) {
+		return check_partitions(solver, board) ? STEP_CHANGED : STEP_NONE;
+	}
+	return parity_check_every_block(solver, board);
+}
+
+// runs whichever rule the schedule expects to decide the most edges per estimated cycle
+static
+uint solve_scheduled(solver_t const *solver, board_t const *board, solve_status_t *status)
+{
+	schedule_t *const schedule = solver->schedule;
+	bool const event_driven = solver->worklist && !solver->justify;
+	begin_schedule(schedule, board);
+	if (event_driven) {
+		reset_worklist(solver, board);
+	}
+
+	step_t step = STEP_NONE;
+	bool is_solved = false;
+	uint step_count = 0;
+	uint const cell_count = board->width*board->height;
+	uint synced_generation = schedule->generation;
+	for (uint task = next_task(schedule); task != NO_TASK; task = next_task(schedule)) {
+		if (event_driven && synced_generation != schedule->generation) {
+			sync_worklist(solver, board);
+			synced_generation = schedule->generation;
+		}
+		if (solver->verbose && !event_driven) {
+			copy_edges_to_solver(solver, board);
+		}
+
+		rule_t const rule = (task < RULE_PARITY) ? (rule_t)task : RULE_PARITY;
+		uint64_t const start = begin_rule(solver);
+		schedule->decided_count = 0;
+		schedule->visit_count = cell_count;
+		bool changed = false;
+		if (rule == RULE_SINGLE_CELLS && event_driven) {
+			schedule->visit_count = solver->worklist->count;
+			changed = check_single_cells_queued(solver, board);
+		} else if (rule == RULE_SINGLE_CELLS) {
+			changed = (solver->bitboard && !solver->justify) ? check_single_cells_bitboard(solver, board) : check_single_cells(solver, board);
+		} else if (rule == RULE_LOOPS) {
+			step = check_loops(solver, board, &is_solved);
+			changed = (step == STEP_CHANGED);
+		} else if (rule == RULE_PARTITIONS) {
+			schedule->visit_count = event_driven ? solver->worklist->partition_edge_count : cell_count;
+			changed = event_driven ? check_partitions_queued(solver, board) : check_partitions(solver, board);
+		} else {
+			// parity_check_all_blocks counts the blocks it checks
+			schedule->visit_count = 0;
+			if (schedule->parity_generation != schedule->generation) {
+				begin_parity_sweep(solver, board);
+				schedule->parity_generation = schedule->generation;
+			}
+			uint w, h;
+			parity_task_size(schedule, task, &w, &h);
+			step = parity_check_block_size(solver, board, w, h);
+			changed = (step == STEP_CHANGED);
+		}
+		end_rule(solver, board, rule, start, changed);
+		end_task(schedule, task, schedule->visit_count, changed ? max(schedule->decided_count, 1) : 0);
+		if (changed) {
+			++step_count;
+			continue;
+		}
+		if (is_solved || step == STEP_CONTRADICTION) {
+			break;
+		}
+	}
+	*status = (step == STEP_CONTRADICTION) ? SOLVE_CONTRADICTION : is_solved ? SOLVE_SOLVED : SOLVE_GIVEN_UP;
+	if (solver->stats) {
+		solver->stats->step_count += step_count;
+	}
+	if (solver->trace) {
+		trace_end(solver->trace, *status, step_count);
+	}
+	return step_count;
+}
+
+uint solve(solver_t const *solver, board_t const *board, solve_status_t *status)
+{
+	if (solver->verbose) {
+		fputs("\ninitial conditions:\n", stdout);
+		print_board(solver, board, EDGE_BOUNDARY);
+	}
+	if (solver->stats) {
+		reserve_stats(solver->stats, board);
+		++solver->stats->solve_count;
+		solver->stats->decided_count = 0;
+	}
+	if (solver->trace) {
+		trace_begin(solver->trace, board);
+	}
+	if (solver->bitboard) {
+		pack_bitboard(solver->bitboard, board);
+	}
+	if (solver->rounds) {
+		return solve_rounds(solver, board, status);
+	}
+	if (solver->schedule) {
+		return solve_scheduled(solver, board, status);
+	}
+	// justifications are only recorded by the plain rules
+	if (solver->worklist && !solver->justify) {
+		return solve_event_driven(solver, board, status);
+	}
+
+	step_t step = STEP_NONE;
+	bool is_solved = false;
+	uint step_count = 0;
+	for (;; ++step_count) {
+		if (solver->verbose) {
+			copy_edges_to_solver(solver, board);
+		}
+
+		uint64_t start = begin_rule(solver);
+		bool changed = (solver->bitboard && !solver->justify) ? check_single_cells_bitboard(solver, board) : check_single_cells(solver, board);
+		end_rule(solver, board, RULE_SINGLE_CELLS, start, changed);
+		if (changed) {
+			continue;
+		}
+
+		start = begin_rule(solver);
+		step = check_loops(solver, board, &is_solved);
+		end_rule(solver, board, RULE_LOOPS, start, step == STEP_CHANGED);
+		if (step == STEP_CHANGED) {
+			continue;
+		}
+		if (is_solved || step == STEP_CONTRADICTION) {
+			break;
+		}
+
+		start = begin_rule(solver);
+		changed = check_partitions(solver, board);
+		end_rule(solver, board, RULE_PARTITIONS, start, changed);
+		if (changed) {
+			continue;
+		}
+
+		start = begin_rule(solver);
+		step = parity_check_all_block_sizes(solver, board);
+		end_rule(solver, board, RULE_PARITY, start, step == STEP_CHANGED);
+		if (step == STEP_CHANGED) {
+			continue;
+		}
+
+		break;
+	}
+	*status = (step == STEP_CONTRADICTION) ? SOLVE_CONTRADICTION : is_solved ? SOLVE_SOLVED : SOLVE_GIVEN_UP;
+	if (solver->stats) {
+		solver->stats->step_count += step_count;
+	}
+	if (solver->trace) {
+		trace_end(solver->trace, *status, step_count);
+	}
+	return step_count;
+}
+
+// list the boundary edges of a board in the order harden tries to remove them, returns the count
+// trials are edge ids, vertical edges after all horizontal ones
+uint harden_trials(board_t const *board, mt_state_t *rng, uint *trials)
+{
+	// check boundary locations on initial board
+	uint const width = board->width;
+	uint const height = board->height;
+	uint const *const edge_h = board->edge_h;
+	uint const *const edge_v = board->edge_v;
+	uint const edge_count_h = width*(height + 1);
+	uint const edge_count_v = (width + 1)*height;
+	uint trial_count = 0;
+	for (uint k = 0; k < edge_count_h; ++k) {
+		if (edge_h[k] & EDGE_BOUNDARY) {
+			trials[trial_count++] = k;
+		}
+	}
+	for (uint k = 0; k < edge_count_v; ++k) {
+		if (edge_v[k] & EDGE_BOUNDARY) {
+			trials[trial_count++] = edge_count_h + k;
+		}
+	}
+
+	// Fisher-Yates shuffle, rejection sampling so every order is equally likely
+	for (uint i = trial_count; i > 1; --i) {
+		uint const limit = 0xffffffffU - (0xffffffffU % i + 1) % i;
+		uint r;
+		do {
+			r = (uint)genrand_int32(rng);
+		} while (r > limit);
+		uint const j = r % i;
+		uint const tmp = trials[i - 1];
+		trials[i - 1] = trials[j];
+		trials[j] = tmp;
+	}
+	return trial_count;
+}
+
+// solve the board with one boundary edge knocked out, leaves the result in test
+bool harden_trial(solver_t const *solver, board_t const *board, board_t *test, uint trial)
+{
+	uint const edge_count_h = board->width*(board->height + 1);
+
+	// copy existing board initial conditions
+	copy_board_edges(test, board);
+	reset_to_boundary(test);
+
+	// knock out the edge
+	if (trial >= edge_count_h) {
+		test->edge_v[trial - edge_count_h] &= ~(EDGE_BOUNDARY | EDGE_BARRIER);
+	} else {
+		test->edge_h[trial] &= ~(EDGE_BOUNDARY | EDGE_BARRIER);
+	}
+	reset_to_boundary(test);
+
+	// keep if still solveable
+	solve_status_t status;
+	solve(solver, test, &status);
+	return status == SOLVE_SOLVED;
+}
+
+// keeps board solved between trials, each trial only undoes the deductions that depended on its wall
+// and solves on from there, returns false if the starting board does not solve
+static
+bool harden_justified(solver_t const *solver, board_t *board, board_t *test, uint const *trials, uint trial_count, uint *success_count)
+{
+	justify_t *const justify = solver->justify;
+	reset_to_boundary(board);
+	justify_begin(justify, board);
+	solve_status_t status;
+	solve(solver, board, &status);
+	if (status != SOLVE_SOLVED) {
+		return false;
+	}
+	justify_commit(justify);
+
+	for (uint trial_index = 0; trial_index < trial_count; ++trial_index) {
+		copy_board_edges(test, board);
+		justify_rewind(justify);
+		justify_retract(justify, test, trials[trial_index]);
+		solve(solver, test, &status);
+		if (status == SOLVE_SOLVED) {
+			swap_board(board, test);
+			justify_commit(justify);
+			++*success_count;
+		}
+	}
+	return true;
+}
+
+// harden using caller-owned scratch: test edges the size of board and 2*(width + 1)*(height + 1) trials
+// board and test may have their edge storage swapped
+uint harden_with_scratch(solver_t const *solver, board_t *board, mt_state_t *rng, board_t *test, uint *trials)
+{
+	uint const trial_count = harden_trials(board, rng, trials);
+
+	// try and remove them in this order
+	test->width = board->width;
+	test->height = board->height;
+	uint success_count = 0;
+	if (solver->justify && harden_justified(solver, board, test, trials, trial_count, &success_count)) {
+		reset_to_boundary(board);
+		return success_count;
+	}
+
+	// re-solve each trial from scratch, without a record nothing would read
+	solver_t plain = *solver;
+	plain.justify = NULL;
+	for (uint trial_index = 0; trial_index < trial_count; ++trial_index) {
+		if (harden_trial(&plain, board, test, trials[trial_index])) {
+			swap_board(board, test);
+			++success_count;
+		}
+	}
+	reset_to_boundary(board);
+	return success_count;
+}
+
+uint harden(solver_t const *solver, board_t *board, mt_state_t *rng)
+{
+	uint *const trials = (uint *)malloc(2*(board->width + 1)*(board->height + 1)*sizeof(uint));
+	board_t test;
+	copy_board(&test, board);
+	uint const success_count = harden_with_scratch(solver, board, rng, &test, trials);
+	free_board(&test);
+	free(trials);
+	return success_count;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "board.h"
+#include "mt19937.h"
+
+// union-find root with path halving
+static inline
+uint find_root(uint *parent, uint i)
+{
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+void reset_to_boundary(board_t *board);
+void copy_board(board_t *dst, board_t const *src);
+void copy_board_edges(board_t *dst, board_t const *src);
+void swap_board(board_t *a, board_t *b);
+void free_board(board_t *board);
+
+bool init_solver(solver_t *solver, board_t const *board);
+void free_solver(solver_t *solver);
+void reserve_solver(solver_t *solver, board_t const *board);
+void copy_edges_to_solver(solver_t const *solver, board_t const *board);
+void decide_edge(solver_t const *solver, board_t const *board, uint k, uint bits);
+bool init_worklist(worklist_t *worklist, board_t const *board);
+void free_worklist(worklist_t *worklist);
+
+// single parity blocks, for sweep.c
+bool parity_block_is_dirty(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1);
+step_t parity_check_block(solver_t const *solver, board_t const *board, uint x0, uint y0, uint x1, uint y1);
+
+// a rule to its own fixed point, for rounds.c
+step_t run_rule(solver_t const *solver, board_t const *board, rule_t rule, bool *is_solved);
+
+uint solve(solver_t const *solver, board_t const *board, solve_status_t *status);
+uint harden_trials(board_t const *board, mt_state_t *rng, uint *trials);
+bool harden_trial(solver_t const *solver, board_t const *board, board_t *test, uint trial);
+uint harden_with_scratch(solver_t const *solver, board_t *board, mt_state_t *rng, board_t *test, uint *trials);
+uint harden(solver_t const *solver, board_t *board, mt_state_t *rng);
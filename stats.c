@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static char const *const rule_names[RULE_COUNT] = {
+	"single_cells",
+	"loops",
+	"partitions",
+	"parity"
+};
+
+uint64_t stats_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void init_stats(stats_t *stats)
+{
+	memset(stats, 0, sizeof(stats_t));
+	stats->start_cycles = read_cycles();
+	stats->start_ns = stats_now_ns();
+}
+
+void free_stats(stats_t *stats)
+{
+	free(stats->parity_block_counts);
+	memset(stats, 0, sizeof(stats_t));
+}
+
+// grow the per block size counts, only when a larger board is seen
+void reserve_stats(stats_t *stats, board_t const *board)
+{
+	if (board->width <= stats->max_width && board->height <= stats->max_height) {
+		return;
+	}
+	uint const max_width = max(board->width, stats->max_width);
+	uint const max_height = max(board->height, stats->max_height);
+	uint64_t *const counts = (uint64_t *)calloc((max_width + 1)*(max_height + 1), sizeof(uint64_t));
+	if (stats->parity_block_counts) {
+		for (uint h = 0; h <= stats->max_height; ++h)
+		for (uint w = 0; w <= stats->max_width; ++w) {
+			counts[h*(max_width + 1) + w] = stats->parity_block_counts[h*(stats->max_width + 1) + w];
+		}
+		free(stats->parity_block_counts);
+	}
+	stats->parity_block_counts = counts;
+	stats->max_width = max_width;
+	stats->max_height = max_height;
+}
+
+void merge_stats(stats_t *dst, stats_t const *src)
+{
+	for (uint i = 0; i < RULE_COUNT; ++i) {
+		dst->rules[i].call_count += src->rules[i].call_count;
+		dst->rules[i].success_count += src->rules[i].success_count;
+		dst->rules[i].edge_count += src->rules[i].edge_count;
+		dst->rules[i].cycle_count += src->rules[i].cycle_count;
+	}
+	dst->solve_count += src->solve_count;
+	dst->step_count += src->step_count;
+	dst->parity_cache_hits += src->parity_cache_hits;
+	if (!src->parity_block_counts) {
+		return;
+	}
+
+	board_t size;
+	memset(&size, 0, sizeof(board_t));
+	size.width = src->max_width;
+	size.height = src->max_height;
+	reserve_stats(dst, &size);
+	for (uint h = 0; h <= src->max_height; ++h)
+	for (uint w = 0; w <= src->max_width; ++w) {
+		dst->parity_block_counts[h*(dst->max_width + 1) + w] += src->parity_block_counts[h*(src->max_width + 1) + w];
+	}
+}
+
+// for counters gathered on another thread, which keeps counting into src from zero
+void drain_stats(stats_t *dst, stats_t *src)
+{
+	merge_stats(dst, src);
+	memset(src->rules, 0, sizeof(src->rules));
+	src->solve_count = 0;
+	src->step_count = 0;
+	src->parity_cache_hits = 0;
+	if (src->parity_block_counts) {
+		memset(src->parity_block_counts, 0, (src->max_width + 1)*(src->max_height + 1)*sizeof(uint64_t));
+	}
+}
+
+void print_stats(FILE *fp, stats_t const *stats, bool is_json)
+{
+	// calibrate the cycle counter against the wall clock over the whole run
+	uint64_t const elapsed_cycles = read_cycles() - stats->start_cycles;
+	uint64_t const elapsed_ns = stats_now_ns() - stats->start_ns;
+	double const ns_per_cycle = (elapsed_cycles > 0) ? (double)elapsed_ns/(double)elapsed_cycles : 0.0;
+
+	// no grid until the first solve
+	uint const row_count = stats->parity_block_counts ? stats->max_height + 1 : 0;
+
+	if (is_json) {
+		fprintf(fp, "{\"solves\":%llu,\"steps\":%llu,\"rules\":{", (unsigned long long)stats->solve_count, (unsigned long long)stats->step_count);
+		for (uint i = 0; i < RULE_COUNT; ++i) {
+			rule_stats_t const *const rule = stats->rules + i;
+			fprintf(fp, "%s\"%s\":{\"calls\":%llu,\"successes\":%llu,\"edges\":%llu,\"cycles\":%llu,\"ms\":%.3f}",
+				(i > 0) ? "," : "", rule_names[i],
+				(unsigned long long)rule->call_count, (unsigned long long)rule->success_count,
+				(unsigned long long)rule->edge_count, (unsigned long long)rule->cycle_count,
+				1e-6*ns_per_cycle*(double)rule->cycle_count);
+		}
+		fputs("},\"parity_blocks\":[", fp);
+		bool is_first = true;
+		for (uint h = 0; h < row_count; ++h)
+		for (uint w = 0; w <= stats->max_width; ++w) {
+			uint64_t const count = stats->parity_block_counts[h*(stats->max_width + 1) + w];
+			if (count != 0) {
+				fprintf(fp, "%s{\"w\":%u,\"h\":%u,\"count\":%llu}", is_first ? "" : ",", w, h, (unsigned long long)count);
+				is_first = false;
+			}
+		}
+		fprintf(fp, "],\"parity_cache_hits\":%llu}\n", (unsigned long long)stats->parity_cache_hits);
+		return;
+	}
+
+	uint64_t total_cycles = 0;
+	for (uint i = 0; i < RULE_COUNT; ++i) {
+		total_cycles += stats->rules[i].cycle_count;
+	}
+	fprintf(fp, "\n%llu solves, %llu steps\n", (unsigned long long)stats->solve_count, (unsigned long long)stats->step_count);
+	fprintf(fp, "%-14s %12s %12s %12s %14s %10s %6s\n", "rule", "calls", "successes", "edges", "cycles", "ms", "time%");
+	for (uint i = 0; i < RULE_COUNT; ++i) {
+		rule_stats_t const *const rule = stats->rules + i;
+		fprintf(fp, "%-14s %12llu %12llu %12llu %14llu %10.3f %5.1f%%\n", rule_names[i],
+			(unsigned long long)rule->call_count, (unsigned long long)rule->success_count,
+			(unsigned long long)rule->edge_count, (unsigned long long)rule->cycle_count,
+			1e-6*ns_per_cycle*(double)rule->cycle_count,
+			(total_cycles > 0) ? 100.0*(double)rule->cycle_count/(double)total_cycles : 0.0);
+	}
+	fputs("\nparity blocks checked by size:\n", fp);
+	for (uint h = 0; h < row_count; ++h)
+	for (uint w = 0; w <= stats->max_width; ++w) {
+		uint64_t const count = stats->parity_block_counts[h*(stats->max_width + 1) + w];
+		if (count != 0) {
+			fprintf(fp, "%4ux%-4u %12llu\n", w, h, (unsigned long long)count);
+		}
+	}
+	fprintf(fp, "\nparity blocks skipped by the cache: %llu\n", (unsigned long long)stats->parity_cache_hits);
+}
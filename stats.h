@@ -0,0 +1,28 @@
+#pragma once
+
+#include "board.h"
+#include <stdio.h>
+
+uint64_t stats_now_ns(void);
+
+// raw cycle counter where there is one, otherwise nanoseconds
+static inline
+uint64_t read_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+	uint64_t t;
+	__asm__ volatile("mrs %0, cntvct_el0" : "=r"(t));
+	return t;
+#else
+	return stats_now_ns();
+#endif
+}
+
+void init_stats(stats_t *stats);
+void free_stats(stats_t *stats);
+void reserve_stats(stats_t *stats, board_t const *board);
+void merge_stats(stats_t *dst, stats_t const *src);
+void drain_stats(stats_t *dst, stats_t *src);
+void print_stats(FILE *fp, stats_t const *stats, bool is_json);
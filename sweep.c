@@ -0,0 +1,258 @@
+#include "sweep.h"
+#include "solver.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// blocks handed out at a time, thread i takes chunks i, i + thread_count, ... so every
+// thread works near the front of the sweep where the first deduction usually is
+#define SWEEP_CHUNK			16
+#define NO_BLOCK			(~0ULL)
+
+struct parity_sweep_t;
+
+typedef struct
+{
+	struct parity_sweep_t *sweep;
+	uint index;
+	pthread_t thread;
+	solver_t scratch;		// private tmp1, tmp2, island counts and parity cache
+	stats_t stats;			// block counts and cache hits, added to the caller's after each round
+	board_t board;			// copy of the board for this round, a deduction only changes this
+} sweeper_t;
+
+typedef struct parity_sweep_t
+{
+	uint thread_count;
+	sweeper_t *sweepers;
+	pthread_mutex_t lock;
+	pthread_cond_t round_start;
+	pthread_cond_t round_done;
+	uint round;				// incremented to start each round
+	uint pending_count;
+	bool is_finished;
+	solver_t const *solver;	// round in progress, only read by the threads
+	board_t const *board;
+	uint first_size;
+	uint size_count;
+	uint clean;				// worklist generation blocks must have changed since, 0 for all
+	uint64_t *size_start;	// first block index of each size in the round: size_count + 1
+	uint size_capacity;
+	uint64_t best;			// lowest block that deduced anything, lowered atomically
+} parity_sweep_t;
+
+static
+void size_of(board_t const *board, uint size, uint *w, uint *h)
+{
+	*w = size % (board->width - 1) + 2;
+	*h = size/(board->width - 1) + 2;
+}
+
+static
+void lower_best(parity_sweep_t *sweep, uint64_t block)
+{
+	uint64_t best = __atomic_load_n(&sweep->best, __ATOMIC_RELAXED);
+	while (block < best && !__atomic_compare_exchange_n(&sweep->best, &best, block, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
+
+// the parity sums, hashes and any dirty sums come from the caller's solver, scratch is our own
+static
+void run_sweeper(sweeper_t *sweeper)
+{
+	parity_sweep_t *const sweep = sweeper->sweep;
+	board_t const *const board = sweep->board;
+	uint const width = board->width;
+	uint64_t const *const size_start = sweep->size_start;
+	uint64_t const block_count = size_start[sweep->size_count];
+
+	if (sweeper->board.width != width || sweeper->board.height != board->height) {
+		free_board(&sweeper->board);
+		copy_board(&sweeper->board, board);
+	} else {
+		copy_board_edges(&sweeper->board, board);
+	}
+	reserve_solver(&sweeper->scratch, board);
+	solver_t solver = *sweep->solver;
+	solver.tmp1 = sweeper->scratch.tmp1;
+	solver.tmp2 = sweeper->scratch.tmp2;
+	solver.island_counts = sweeper->scratch.island_counts;
+	solver.parity_cache = sweeper->scratch.parity_cache;
+	solver.parity_cache_mask = sweeper->scratch.parity_cache_mask;
+	solver.stats = sweep->solver->stats ? &sweeper->stats : NULL;
+	solver.trace = NULL;
+	solver.justify = NULL;
+	solver.bitboard = NULL;
+	solver.schedule = NULL;
+	solver.verbose = false;
+	if (solver.stats) {
+		reserve_stats(solver.stats, board);
+	}
+
+	uint size = 0;
+	for (uint64_t begin = (uint64_t)sweeper->index*SWEEP_CHUNK; begin < block_count; begin += sweep->thread_count*SWEEP_CHUNK) {
+		if (begin >= __atomic_load_n(&sweep->best, __ATOMIC_RELAXED)) {
+			return;
+		}
+		uint64_t const end = (begin + SWEEP_CHUNK < block_count) ? begin + SWEEP_CHUNK : block_count;
+		for (uint64_t i = begin; i < end; ++i) {
+			while (i >= size_start[size + 1]) {
+				++size;
+			}
+			uint w, h;
+			size_of(board, sweep->first_size + size, &w, &h);
+			uint const position = (uint)(i - size_start[size]);
+			uint const x = position % (width - w + 1);
+			uint const y = position/(width - w + 1);
+			if (sweep->clean != 0 && !parity_block_is_dirty(&solver, board, x, y, x + w, y + h)) {
+				continue;
+			}
+			if (solver.stats) {
+				++solver.stats->parity_block_counts[h*(solver.stats->max_width + 1) + w];
+			}
+			if (parity_check_block(&solver, &sweeper->board, x, y, x + w, y + h) != STEP_NONE) {
+				lower_best(sweep, i);
+				return;
+			}
+		}
+	}
+}
+
+static
+void *sweeper_main(void *arg)
+{
+	sweeper_t *const sweeper = (sweeper_t *)arg;
+	parity_sweep_t *const sweep = sweeper->sweep;
+	uint round = 0;
+	for (;;) {
+		pthread_mutex_lock(&sweep->lock);
+		while (sweep->round == round && !sweep->is_finished) {
+			pthread_cond_wait(&sweep->round_start, &sweep->lock);
+		}
+		bool const is_finished = sweep->is_finished;
+		round = sweep->round;
+		pthread_mutex_unlock(&sweep->lock);
+		if (is_finished) {
+			break;
+		}
+
+		run_sweeper(sweeper);
+
+		pthread_mutex_lock(&sweep->lock);
+		if (--sweep->pending_count == 0) {
+			pthread_cond_signal(&sweep->round_done);
+		}
+		pthread_mutex_unlock(&sweep->lock);
+	}
+	return NULL;
+}
+
+struct parity_sweep_t *create_parity_sweep(board_t const *board, uint thread_count)
+{
+	parity_sweep_t *const sweep = (parity_sweep_t *)calloc(1, sizeof(parity_sweep_t));
+	sweep->thread_count = max(thread_count, 1);
+	sweep->sweepers = (sweeper_t *)calloc(sweep->thread_count, sizeof(sweeper_t));
+	pthread_mutex_init(&sweep->lock, NULL);
+	pthread_cond_init(&sweep->round_start, NULL);
+	pthread_cond_init(&sweep->round_done, NULL);
+	for (uint i = 0; i < sweep->thread_count; ++i) {
+		sweeper_t *const sweeper = sweep->sweepers + i;
+		sweeper->sweep = sweep;
+		sweeper->index = i;
+		init_solver(&sweeper->scratch, board);
+		init_stats(&sweeper->stats);
+		copy_board(&sweeper->board, board);
+		if (i > 0) {
+			pthread_create(&sweeper->thread, NULL, sweeper_main, sweeper);
+		}
+	}
+	return sweep;
+}
+
+void destroy_parity_sweep(struct parity_sweep_t *sweep)
+{
+	pthread_mutex_lock(&sweep->lock);
+	sweep->is_finished = true;
+	pthread_cond_broadcast(&sweep->round_start);
+	pthread_mutex_unlock(&sweep->lock);
+	for (uint i = 0; i < sweep->thread_count; ++i) {
+		sweeper_t *const sweeper = sweep->sweepers + i;
+		if (i > 0) {
+			pthread_join(sweeper->thread, NULL);
+		}
+		free_solver(&sweeper->scratch);
+		free_stats(&sweeper->stats);
+		free_board(&sweeper->board);
+	}
+	pthread_cond_destroy(&sweep->round_done);
+	pthread_cond_destroy(&sweep->round_start);
+	pthread_mutex_destroy(&sweep->lock);
+	free(sweep->size_start);
+	free(sweep->sweepers);
+	free(sweep);
+}
+
+uint parity_sweep_thread_count(struct parity_sweep_t const *sweep)
+{
+	return sweep->thread_count;
+}
+
+// same result as checking each size in turn with parity_check_all_blocks, build the parity
+// sums and hashes (and dirty sums if clean is set) first
+step_t sweep_parity_blocks(struct parity_sweep_t *sweep, solver_t const *solver, board_t const *board, uint first_size, uint size_count, uint clean)
+{
+	if (size_count + 1 > sweep->size_capacity) {
+		free(sweep->size_start);
+		sweep->size_capacity = size_count + 1;
+		sweep->size_start = (uint64_t *)malloc(sweep->size_capacity*sizeof(uint64_t));
+	}
+	sweep->size_start[0] = 0;
+	for (uint i = 0; i < size_count; ++i) {
+		uint w, h;
+		size_of(board, first_size + i, &w, &h);
+		sweep->size_start[i + 1] = sweep->size_start[i] + (uint64_t)(board->width - w + 1)*(board->height - h + 1);
+	}
+	sweep->solver = solver;
+	sweep->board = board;
+	sweep->first_size = first_size;
+	sweep->size_count = size_count;
+	sweep->clean = clean;
+	sweep->best = NO_BLOCK;
+
+	pthread_mutex_lock(&sweep->lock);
+	sweep->pending_count = sweep->thread_count - 1;
+	++sweep->round;
+	pthread_cond_broadcast(&sweep->round_start);
+	pthread_mutex_unlock(&sweep->lock);
+
+	run_sweeper(sweep->sweepers);
+
+	pthread_mutex_lock(&sweep->lock);
+	while (sweep->pending_count != 0) {
+		pthread_cond_wait(&sweep->round_done, &sweep->lock);
+	}
+	pthread_mutex_unlock(&sweep->lock);
+
+	// counters from the threads go to the caller's stats, as if it had checked the blocks itself
+	if (solver->stats) {
+		for (uint i = 0; i < sweep->thread_count; ++i) {
+			drain_stats(solver->stats, &sweep->sweepers[i].stats);
+		}
+	}
+	if (sweep->best == NO_BLOCK) {
+		return STEP_NONE;
+	}
+
+	// every block before it found nothing, so this is the one the serial sweep would stop at
+	uint size = 0;
+	while (sweep->best >= sweep->size_start[size + 1]) {
+		++size;
+	}
+	uint w, h;
+	size_of(board, first_size + size, &w, &h);
+	uint const position = (uint)(sweep->best - sweep->size_start[size]);
+	uint const x = position % (board->width - w + 1);
+	uint const y = position/(board->width - w + 1);
+	return parity_check_block(solver, board, x, y, x + w, y + h);
+}
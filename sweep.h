@@ -0,0 +1,14 @@
+#pragma once
+
+#include "board.h"
+
+// threads that share out the block positions of one parity sweep within a single solve
+// each scans its own chunks on a private copy of the board and stops at its first deduction,
+// then the caller redoes the lowest block that deduced anything on the real board, which is
+// the block the serial sweep stops at, so results do not depend on the thread count
+// sizes are numbered in sweep order, (h - 2)*(width - 1) + (w - 2)
+
+struct parity_sweep_t *create_parity_sweep(board_t const *board, uint thread_count);
+void destroy_parity_sweep(struct parity_sweep_t *sweep);
+uint parity_sweep_thread_count(struct parity_sweep_t const *sweep);
+step_t sweep_parity_blocks(struct parity_sweep_t *sweep, solver_t const *solver, board_t const *board, uint first_size, uint size_count, uint clean);
@@ -0,0 +1,271 @@
+#include "trace.h"
+#include "solver.h"
+#include "io.h"
+#include <stdlib.h>
+#include <string.h>
+
+// same headings as the verbose output of each rule
+static char const *const rule_titles[RULE_COUNT] = {
+	"single cells",
+	"avoid loops and short paths",
+	"avoid partitioning",
+	"parity check"
+};
+
+static
+void reserve_buffer(trace_t *trace, size_t count)
+{
+	if (trace->buffer_count + count > trace->buffer_capacity) {
+		while (trace->buffer_count + count > trace->buffer_capacity) {
+			trace->buffer_capacity *= 2;
+		}
+		trace->buffer = (uint8_t *)realloc(trace->buffer, trace->buffer_capacity);
+	}
+}
+
+static inline
+void put_u8(trace_t *trace, uint value)
+{
+	trace->buffer[trace->buffer_count++] = (uint8_t)value;
+}
+
+static inline
+void put_u32(trace_t *trace, uint value)
+{
+	uint8_t *const p = trace->buffer + trace->buffer_count;
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+	trace->buffer_count += 4;
+}
+
+static
+void flush_trace(trace_t *trace)
+{
+	fwrite(trace->buffer, 1, trace->buffer_count, trace->fp);
+	trace->buffer_count = 0;
+}
+
+bool open_trace(trace_t *trace, char const *path)
+{
+	memset(trace, 0, sizeof(trace_t));
+	trace->fp = fopen(path, "wb");
+	if (!trace->fp) {
+		fprintf(stderr, "failed to open \"%s\" for writing!\n", path);
+		return false;
+	}
+	trace->buffer_capacity = 1 << 16;
+	trace->buffer = (uint8_t *)malloc(trace->buffer_capacity);
+	memcpy(trace->buffer, "AZTR", 4);
+	trace->buffer_count = 4;
+	put_u32(trace, TRACE_VERSION);
+	return true;
+}
+
+void close_trace(trace_t *trace)
+{
+	flush_trace(trace);
+	fclose(trace->fp);
+	free(trace->buffer);
+	free(trace->shadow);
+	free(trace->changes);
+	memset(trace, 0, sizeof(trace_t));
+}
+
+// record the starting edges, later steps only record differences from these
+void trace_begin(trace_t *trace, board_t const *board)
+{
+	uint const edge_count_h = board->width*(board->height + 1);
+	uint const edge_count = edge_count_h + (board->width + 1)*board->height;
+	if (edge_count > trace->shadow_capacity) {
+		free(trace->shadow);
+		free(trace->changes);
+		trace->shadow = (uint8_t *)malloc(edge_count);
+		trace->changes = (uint *)malloc(edge_count*sizeof(uint));
+		trace->shadow_capacity = edge_count;
+	}
+	trace->change_count = 0;
+	for (uint k = 0; k < edge_count_h; ++k) {
+		trace->shadow[k] = (uint8_t)board->edge_h[k];
+	}
+	for (uint k = edge_count_h; k < edge_count; ++k) {
+		trace->shadow[k] = (uint8_t)board->edge_v[k - edge_count_h];
+	}
+
+	reserve_buffer(trace, 9 + edge_count);
+	put_u8(trace, TRACE_SOLVE);
+	put_u32(trace, board->width);
+	put_u32(trace, board->height);
+	memcpy(trace->buffer + trace->buffer_count, trace->shadow, edge_count);
+	trace->buffer_count += edge_count;
+}
+
+// called by decide_edge before edge k changes from bits, only its first change since the last record is kept
+void trace_edge(trace_t *trace, uint k, uint bits)
+{
+	if (trace->shadow[k] == bits) {
+		trace->changes[trace->change_count++] = k;
+	}
+}
+
+static
+int compare_edges(void const *a, void const *b)
+{
+	uint const ka = *(uint const *)a;
+	uint const kb = *(uint const *)b;
+	return (ka > kb) - (ka < kb);
+}
+
+// after a rule succeeded, the edges it changed are appended to the buffer in edge order
+void trace_step(trace_t *trace, board_t const *board, rule_t rule)
+{
+	uint const edge_count_h = board->width*(board->height + 1);
+
+	reserve_buffer(trace, 6);
+	put_u8(trace, TRACE_STEP);
+	put_u8(trace, rule);
+	size_t const count_offset = trace->buffer_count;
+	put_u32(trace, 0);
+
+	uint change_count = 0;
+	qsort(trace->changes, trace->change_count, sizeof(uint), compare_edges);
+	for (uint i = 0; i < trace->change_count; ++i) {
+		uint const k = trace->changes[i];
+		uint const bits = (k < edge_count_h) ? board->edge_h[k] : board->edge_v[k - edge_count_h];
+		if (bits != trace->shadow[k]) {
+			trace->shadow[k] = (uint8_t)bits;
+			reserve_buffer(trace, 5);
+			put_u32(trace, k);
+			put_u8(trace, bits);
+			++change_count;
+		}
+	}
+	trace->change_count = 0;
+
+	size_t const end = trace->buffer_count;
+	trace->buffer_count = count_offset;
+	put_u32(trace, change_count);
+	trace->buffer_count = end;
+}
+
+void trace_end(trace_t *trace, solve_status_t status, uint step_count)
+{
+	reserve_buffer(trace, 6);
+	put_u8(trace, TRACE_END);
+	put_u8(trace, status);
+	put_u32(trace, step_count);
+	flush_trace(trace);
+}
+
+static
+bool get_u8(FILE *fp, uint *value)
+{
+	int const c = getc(fp);
+	*value = (uint)c;
+	return c != EOF;
+}
+
+static
+bool get_u32(FILE *fp, uint *value)
+{
+	uint8_t p[4];
+	if (fread(p, 1, 4, fp) != 4) {
+		return false;
+	}
+	*value = (uint)p[0] | ((uint)p[1] << 8) | ((uint)p[2] << 16) | ((uint)p[3] << 24);
+	return true;
+}
+
+// print a recorded solve the way -v would have, new edges are shown but rule highlights are not recorded
+static
+bool replay_solve(FILE *fp)
+{
+	board_t board;
+	memset(&board, 0, sizeof(board_t));
+	if (!get_u32(fp, &board.width) || !get_u32(fp, &board.height) || board.width == 0 || board.height == 0) {
+		return false;
+	}
+	uint const width = board.width;
+	uint const height = board.height;
+	uint const edge_count_h = width*(height + 1);
+	uint const edge_count = edge_count_h + (width + 1)*height;
+	board.edge_h = (uint *)malloc(edge_count_h*sizeof(uint));
+	board.edge_v = (uint *)malloc((width + 1)*height*sizeof(uint));
+	bool is_valid = true;
+	for (uint k = 0; k < edge_count && is_valid; ++k) {
+		is_valid = get_u8(fp, (k < edge_count_h) ? (board.edge_h + k) : (board.edge_v + k - edge_count_h));
+	}
+
+	solver_t solver;
+	init_solver(&solver, &board);
+	memset(solver.tmp1, 0, width*height*sizeof(uint));
+	if (is_valid) {
+		fputs("\ninitial conditions:\n", stdout);
+		print_board(&solver, &board, EDGE_BOUNDARY);
+	}
+
+	while (is_valid) {
+		uint record;
+		if (!get_u8(fp, &record)) {
+			is_valid = false;
+		} else if (record == TRACE_STEP) {
+			uint rule;
+			uint change_count;
+			is_valid = get_u8(fp, &rule) && rule < RULE_COUNT && get_u32(fp, &change_count);
+			copy_edges_to_solver(&solver, &board);
+			for (uint i = 0; i < change_count && is_valid; ++i) {
+				uint k;
+				uint bits;
+				is_valid = get_u32(fp, &k) && get_u8(fp, &bits) && k < edge_count;
+				if (is_valid) {
+					*((k < edge_count_h) ? (board.edge_h + k) : (board.edge_v + k - edge_count_h)) = bits;
+				}
+			}
+			if (is_valid) {
+				printf("\n%s:\n", rule_titles[rule]);
+				print_board(&solver, &board, EDGE_ALL | EDGE_NEW);
+			}
+		} else if (record == TRACE_END) {
+			uint status;
+			uint step_count;
+			is_valid = get_u8(fp, &status) && get_u32(fp, &step_count);
+			if (is_valid) {
+				char const *const result = (status == SOLVE_SOLVED) ? "solved" : (status == SOLVE_CONTRADICTION) ? "contradiction" : "given up";
+				printf("\n%s after %d steps!\n", result, step_count);
+				print_board(&solver, &board, EDGE_SOLUTION);
+			}
+			break;
+		} else {
+			is_valid = false;
+		}
+	}
+
+	free_solver(&solver);
+	free_board(&board);
+	return is_valid;
+}
+
+// render every solve in a trace file
+int replay_trace(char const *path)
+{
+	FILE *const fp = fopen(path, "rb");
+	if (!fp) {
+		fprintf(stderr, "failed to open \"%s\" for reading!\n", path);
+		return -1;
+	}
+
+	char magic[4];
+	uint version;
+	bool is_valid = fread(magic, 1, 4, fp) == 4 && memcmp(magic, "AZTR", 4) == 0 && get_u32(fp, &version) && version == TRACE_VERSION;
+	uint record;
+	while (is_valid && get_u8(fp, &record)) {
+		is_valid = (record == TRACE_SOLVE) && replay_solve(fp);
+	}
+	fclose(fp);
+	if (!is_valid) {
+		fprintf(stderr, "\"%s\" is not a valid trace!\n", path);
+		return -1;
+	}
+	return 0;
+}
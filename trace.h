@@ -0,0 +1,29 @@
+#pragma once
+
+#include "board.h"
+#include <stdio.h>
+
+// binary record of a solve: the starting edges, then the edges each successful rule changed
+// all integers are little-endian
+//   file:  "AZTR" u32 version, then any number of solves
+//   solve: u8 TRACE_SOLVE, u32 width, u32 height, one u8 of edge bits per edge
+//   step:  u8 TRACE_STEP, u8 rule, u32 change count, then u32 edge id and u8 new bits per change
+//   end:   u8 TRACE_END, u8 status, u32 step count
+// edge ids number the horizontal edges first, then the vertical edges
+
+#define TRACE_VERSION		1
+
+typedef enum
+{
+	TRACE_SOLVE,
+	TRACE_STEP,
+	TRACE_END
+} trace_record_t;
+
+bool open_trace(trace_t *trace, char const *path);
+void close_trace(trace_t *trace);
+void trace_begin(trace_t *trace, board_t const *board);
+void trace_edge(trace_t *trace, uint k, uint bits);
+void trace_step(trace_t *trace, board_t const *board, rule_t rule);
+void trace_end(trace_t *trace, solve_status_t status, uint step_count);
+int replay_trace(char const *path);